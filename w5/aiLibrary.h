@@ -1,28 +1,29 @@
 #pragma once
 
 #include <functional>
-#include "stateMachine.h"
+#include <vector>
+#include <string>
 #include "behaviourTree.h"
 
-// states
-State *create_attack_enemy_state();
-State *create_move_to_enemy_state();
-State *create_flee_from_enemy_state();
-State *create_patrol_state(float patrol_dist);
-State *create_nop_state();
+using utility_function = std::function<float(Blackboard&)>;
 
-// transitions
-StateTransition *create_enemy_available_transition(float dist);
-StateTransition *create_enemy_reachable_transition();
-StateTransition *create_hitpoints_less_than_transition(float thres);
-StateTransition *create_negate_transition(StateTransition *in);
-StateTransition *create_and_transition(StateTransition *lhs, StateTransition *rhs);
+constexpr size_t max_utility_inputs = 4;
+constexpr size_t max_utility_children = 16;
 
-using utility_function = std::function<float(Blackboard&)>;
+// Utility from blackboard floats. Input names are resolved to slots once, when the tree is built,
+// and scoring reads them by slot into a plain function without captures.
+struct UtilityScorer
+{
+  std::vector<std::string> inputs;
+  float (*score)(const float *inputs);
+};
 
 BehNode *sequence(const std::vector<BehNode*> &nodes);
 BehNode *selector(const std::vector<BehNode*> &nodes);
+// at most max_utility_children nodes, extra ones are deleted
 BehNode *utility_selector(const std::vector<std::pair<BehNode*, utility_function>> &nodes);
+// at most max_utility_children nodes, extra ones are deleted, scorer inputs are registered on the entity blackboard
+BehNode *utility_selector(flecs::entity entity, const std::vector<std::pair<BehNode*, UtilityScorer>> &nodes);
 
 BehNode *move_to_entity(flecs::entity entity, const char *bb_name);
 BehNode *is_low_hp(float thres);
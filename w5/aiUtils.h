@@ -1,6 +1,7 @@
 #pragma once
 #include <flecs.h>
 #include "blackboard.h"
+#include "sensorIndex.h"
 #include <float.h>
 #include "math.h"
 
@@ -22,29 +23,29 @@ inline int inverse_move(int move)
          move == EA_MOVE_DOWN ? EA_MOVE_UP : move;
 }
 
+// xorshift, value in [min, max]
+inline int ai_random_value(AiRandom &rnd, int min, int max)
+{
+  rnd.state ^= rnd.state << 13;
+  rnd.state ^= rnd.state >> 17;
+  rnd.state ^= rnd.state << 5;
+  return min + int(rnd.state % uint32_t(max - min + 1));
+}
+
+// reads the sensor index built for the current turn
 template<typename Callable>
 inline void on_closest_enemy_pos(flecs::world &ecs, flecs::entity entity, Callable c)
 {
-  auto enemiesQuery = ecs.query<const Position, const Team>();
+  const SensorIndex *index = ecs.get<SensorIndex>();
+  if (!index)
+    return; // TODO: Assert
   entity.insert([&](const Position &pos, const Team &t, Action &a)
   {
-    flecs::entity closestEnemy;
-    float closestDist = FLT_MAX;
-    Position closestPos;
-    enemiesQuery.each([&](flecs::entity enemy, const Position &epos, const Team &et)
-    {
-      if (t.team == et.team)
-        return;
-      float curDist = dist(epos, pos);
-      if (curDist < closestDist)
-      {
-        closestDist = curDist;
-        closestPos = epos;
-        closestEnemy = enemy;
-      }
-    });
-    if (ecs.is_valid(closestEnemy))
-      c(a, pos, closestPos);
+    SensorAgent closestEnemy;
+    float closestDist = 0.f;
+    if (sensors::find_nearest_enemy(*index, pos, t.team, FLT_MAX, closestEnemy, closestDist) &&
+        ecs.is_valid(closestEnemy.entity))
+      c(a, pos, closestEnemy.pos);
   });
 }
 
@@ -0,0 +1,144 @@
+#pragma once
+#include <flecs.h>
+#include <cstdint>
+#include <utility>
+#include "raylib.h"
+#include "ecsTypes.h"
+#include "blackboard.h"
+#include "behaviourTree.h"
+#include "aiUtils.h"
+#include "math.h"
+
+// Leaf behaviours and utility selection shared by node trees and compiled trees,
+// blackboard slots are resolved by the caller
+namespace beh
+{
+  struct UtilityScore
+  {
+    float score;
+    uint32_t child;
+  };
+
+  // Moves the best of scores[first, count) to first, ties go to the earlier child.
+  // Selectors call it once per tried child, so scores are only ordered as far as children fail.
+  inline void select_next_utility(UtilityScore *scores, size_t first, size_t count)
+  {
+    size_t best = first;
+    for (size_t i = first + 1; i < count; ++i)
+      if (scores[i].score > scores[best].score ||
+          (scores[i].score == scores[best].score && scores[i].child < scores[best].child))
+        best = i;
+    std::swap(scores[first], scores[best]);
+  }
+
+  inline BehResult tick_move_to_entity(flecs::entity entity, Blackboard &bb, size_t entity_bb)
+  {
+    BehResult res = BEH_RUNNING;
+    entity.insert([&](Action &a, const Position &pos)
+    {
+      flecs::entity targetEntity = bb.get<flecs::entity>(entity_bb);
+      if (!targetEntity.is_alive())
+      {
+        res = BEH_FAIL;
+        return;
+      }
+      targetEntity.get([&](const Position &target_pos)
+      {
+        if (pos != target_pos)
+        {
+          a.action = move_towards(pos, target_pos);
+          res = BEH_RUNNING;
+        }
+        else
+          res = BEH_SUCCESS;
+      });
+    });
+    return res;
+  }
+
+  inline BehResult tick_is_low_hp(flecs::entity entity, float threshold)
+  {
+    BehResult res = BEH_SUCCESS;
+    entity.get([&](const Hitpoints &hp)
+    {
+      res = hp.hitpoints < threshold ? BEH_SUCCESS : BEH_FAIL;
+    });
+    return res;
+  }
+
+  inline BehResult tick_find_enemy(flecs::world &ecs, flecs::entity entity, Blackboard &bb, float distance,
+                                   size_t entity_bb)
+  {
+    BehResult res = BEH_FAIL;
+    const SensorIndex *index = ecs.get<SensorIndex>();
+    if (!index)
+      return res; // TODO: Assert
+    entity.insert([&](const Position &pos, const Team &t)
+    {
+      SensorAgent closestEnemy;
+      float closestDist = 0.f;
+      if (sensors::find_nearest_enemy(*index, pos, t.team, distance, closestEnemy, closestDist) &&
+          ecs.is_valid(closestEnemy.entity))
+      {
+        bb.set<flecs::entity>(entity_bb, closestEnemy.entity);
+        res = BEH_SUCCESS;
+      }
+    });
+    return res;
+  }
+
+  inline BehResult tick_flee(flecs::entity entity, Blackboard &bb, size_t entity_bb)
+  {
+    BehResult res = BEH_RUNNING;
+    entity.insert([&](Action &a, const Position &pos)
+    {
+      flecs::entity targetEntity = bb.get<flecs::entity>(entity_bb);
+      if (!targetEntity.is_alive())
+      {
+        res = BEH_FAIL;
+        return;
+      }
+      targetEntity.get([&](const Position &target_pos)
+      {
+        a.action = inverse_move(move_towards(pos, target_pos));
+      });
+    });
+    return res;
+  }
+
+  // patrol position is the entity position at the time the behaviour is attached
+  inline void init_patrol(flecs::entity entity, Blackboard &bb, size_t ppos_bb)
+  {
+    entity.get([&](const Position &pos)
+    {
+      bb.set<Position>(ppos_bb, pos);
+    });
+  }
+
+  inline BehResult tick_patrol(flecs::entity entity, Blackboard &bb, float patrol_dist, size_t ppos_bb)
+  {
+    BehResult res = BEH_RUNNING;
+    entity.insert([&](Action &a, const Position &pos, AiRandom &rnd)
+    {
+      Position patrolPos = bb.get<Position>(ppos_bb);
+      if (dist(pos, patrolPos) > patrol_dist)
+        a.action = move_towards(pos, patrolPos);
+      else
+        a.action = ai_random_value(rnd, EA_MOVE_START, EA_MOVE_END - 1); // do a random walk
+    });
+    return res;
+  }
+
+  inline BehResult tick_patch_up(flecs::entity entity, float hp_threshold)
+  {
+    BehResult res = BEH_SUCCESS;
+    entity.insert([&](Action &a, Hitpoints &hp)
+    {
+      if (hp.hitpoints >= hp_threshold)
+        return;
+      res = BEH_RUNNING;
+      a.action = EA_HEAL_SELF;
+    });
+    return res;
+  }
+};
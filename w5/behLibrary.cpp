@@ -4,6 +4,7 @@
 #include "math.h"
 #include "raylib.h"
 #include "blackboard.h"
+#include "behLeaves.h"
 #include <algorithm>
 
 struct CompoundNode : public BehNode
@@ -56,22 +57,70 @@ struct UtilitySelector : public BehNode
 {
   std::vector<std::pair<BehNode*, utility_function>> utilityNodes;
 
+  virtual ~UtilitySelector()
+  {
+    for (std::pair<BehNode*, utility_function> &node : utilityNodes)
+      delete node.first;
+    utilityNodes.clear();
+  }
+
   BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
   {
-    std::vector<std::pair<float, size_t>> utilityScores;
-    for (size_t i = 0; i < utilityNodes.size(); ++i)
+    beh::UtilityScore utilityScores[max_utility_children];
+    const size_t count = utilityNodes.size();
+    for (size_t i = 0; i < count; ++i)
+      utilityScores[i] = beh::UtilityScore{utilityNodes[i].second(bb), uint32_t(i)};
+    for (size_t i = 0; i < count; ++i)
     {
-      const float utilityScore = utilityNodes[i].second(bb);
-      utilityScores.push_back(std::make_pair(utilityScore, i));
+      beh::select_next_utility(utilityScores, i, count);
+      BehResult res = utilityNodes[utilityScores[i].child].first->update(ecs, entity, bb);
+      if (res != BEH_FAIL)
+        return res;
     }
-    std::sort(utilityScores.begin(), utilityScores.end(), [](auto &lhs, auto &rhs)
+    return BEH_FAIL;
+  }
+};
+
+struct SlotUtilitySelector : public BehNode
+{
+  struct UtilityNode
+  {
+    BehNode *node;
+    float (*score)(const float *inputs);
+    size_t numInputs;
+    size_t inputSlots[max_utility_inputs];
+    BbSubscription inputsSub; // score is recomputed only when an input changed
+    float lastScore;
+  };
+  std::vector<UtilityNode> utilityNodes;
+
+  virtual ~SlotUtilitySelector()
+  {
+    for (UtilityNode &node : utilityNodes)
+      delete node.node;
+    utilityNodes.clear();
+  }
+
+  BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
+  {
+    beh::UtilityScore utilityScores[max_utility_children];
+    for (size_t i = 0; i < utilityNodes.size(); ++i)
     {
-      return lhs.first > rhs.first;
-    });
-    for (const std::pair<float, size_t> &node : utilityScores)
+      UtilityNode &un = utilityNodes[i];
+      if (bb.needsUpdate(un.inputsSub))
+      {
+        float inputs[max_utility_inputs];
+        for (size_t j = 0; j < un.numInputs; ++j)
+          inputs[j] = bb.get<float>(un.inputSlots[j]);
+        un.lastScore = un.score(inputs);
+        bb.markUpdated(un.inputsSub);
+      }
+      utilityScores[i] = beh::UtilityScore{un.lastScore, uint32_t(i)};
+    }
+    for (size_t i = 0; i < utilityNodes.size(); ++i)
     {
-      size_t nodeIdx = node.second;
-      BehResult res = utilityNodes[nodeIdx].first->update(ecs, entity, bb);
+      beh::select_next_utility(utilityScores, i, utilityNodes.size());
+      BehResult res = utilityNodes[utilityScores[i].child].node->update(ecs, entity, bb);
       if (res != BEH_FAIL)
         return res;
     }
@@ -89,27 +138,7 @@ struct MoveToEntity : public BehNode
 
   BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
   {
-    BehResult res = BEH_RUNNING;
-    entity.insert([&](Action &a, const Position &pos)
-    {
-      flecs::entity targetEntity = bb.get<flecs::entity>(entityBb);
-      if (!targetEntity.is_alive())
-      {
-        res = BEH_FAIL;
-        return;
-      }
-      targetEntity.get([&](const Position &target_pos)
-      {
-        if (pos != target_pos)
-        {
-          a.action = move_towards(pos, target_pos);
-          res = BEH_RUNNING;
-        }
-        else
-          res = BEH_SUCCESS;
-      });
-    });
-    return res;
+    return beh::tick_move_to_entity(entity, bb, entityBb);
   }
 };
 
@@ -120,12 +149,7 @@ struct IsLowHp : public BehNode
 
   BehResult update(flecs::world &, flecs::entity entity, Blackboard &) override
   {
-    BehResult res = BEH_SUCCESS;
-    entity.get([&](const Hitpoints &hp)
-    {
-      res = hp.hitpoints < threshold ? BEH_SUCCESS : BEH_FAIL;
-    });
-    return res;
+    return beh::tick_is_low_hp(entity, threshold);
   }
 };
 
@@ -139,32 +163,7 @@ struct FindEnemy : public BehNode
   }
   BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
   {
-    BehResult res = BEH_FAIL;
-    auto enemiesQuery = ecs.query<const Position, const Team>();
-    entity.insert([&](const Position &pos, const Team &t)
-    {
-      flecs::entity closestEnemy;
-      float closestDist = FLT_MAX;
-      Position closestPos;
-      enemiesQuery.each([&](flecs::entity enemy, const Position &epos, const Team &et)
-      {
-        if (t.team == et.team)
-          return;
-        float curDist = dist(epos, pos);
-        if (curDist < closestDist)
-        {
-          closestDist = curDist;
-          closestPos = epos;
-          closestEnemy = enemy;
-        }
-      });
-      if (ecs.is_valid(closestEnemy) && closestDist <= distance)
-      {
-        bb.set<flecs::entity>(entityBb, closestEnemy);
-        res = BEH_SUCCESS;
-      }
-    });
-    return res;
+    return beh::tick_find_enemy(ecs, entity, bb, distance, entityBb);
   }
 };
 
@@ -178,21 +177,7 @@ struct Flee : public BehNode
 
   BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
   {
-    BehResult res = BEH_RUNNING;
-    entity.insert([&](Action &a, const Position &pos)
-    {
-      flecs::entity targetEntity = bb.get<flecs::entity>(entityBb);
-      if (!targetEntity.is_alive())
-      {
-        res = BEH_FAIL;
-        return;
-      }
-      targetEntity.get([&](const Position &target_pos)
-      {
-        a.action = inverse_move(move_towards(pos, target_pos));
-      });
-    });
-    return res;
+    return beh::tick_flee(entity, bb, entityBb);
   }
 };
 
@@ -204,24 +189,15 @@ struct Patrol : public BehNode
     : patrolDist(patrol_dist)
   {
     pposBb = reg_entity_blackboard_var<Position>(entity, bb_name);
-    entity.insert([&](Blackboard &bb, const Position &pos)
+    entity.insert([&](Blackboard &bb)
     {
-      bb.set<Position>(pposBb, pos);
+      beh::init_patrol(entity, bb, pposBb);
     });
   }
 
   BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
   {
-    BehResult res = BEH_RUNNING;
-    entity.insert([&](Action &a, const Position &pos)
-    {
-      Position patrolPos = bb.get<Position>(pposBb);
-      if (dist(pos, patrolPos) > patrolDist)
-        a.action = move_towards(pos, patrolPos);
-      else
-        a.action = GetRandomValue(EA_MOVE_START, EA_MOVE_END - 1); // do a random walk
-    });
-    return res;
+    return beh::tick_patrol(entity, bb, patrolDist, pposBb);
   }
 };
 
@@ -232,15 +208,7 @@ struct PatchUp : public BehNode
 
   BehResult update(flecs::world &, flecs::entity entity, Blackboard &) override
   {
-    BehResult res = BEH_SUCCESS;
-    entity.insert([&](Action &a, Hitpoints &hp)
-    {
-      if (hp.hitpoints >= hpThreshold)
-        return;
-      res = BEH_RUNNING;
-      a.action = EA_HEAL_SELF;
-    });
-    return res;
+    return beh::tick_patch_up(entity, hpThreshold);
   }
 };
 
@@ -265,7 +233,36 @@ BehNode *selector(const std::vector<BehNode*> &nodes)
 BehNode *utility_selector(const std::vector<std::pair<BehNode*, utility_function>> &nodes)
 {
   UtilitySelector *usel = new UtilitySelector;
-  usel->utilityNodes = std::move(nodes);
+  for (const std::pair<BehNode*, utility_function> &node : nodes)
+  {
+    if (usel->utilityNodes.size() == max_utility_children)
+    {
+      delete node.first;
+      continue; // TODO: Assert
+    }
+    usel->utilityNodes.push_back(node);
+  }
+  return usel;
+}
+
+BehNode *utility_selector(flecs::entity entity, const std::vector<std::pair<BehNode*, UtilityScorer>> &nodes)
+{
+  SlotUtilitySelector *usel = new SlotUtilitySelector;
+  for (const std::pair<BehNode*, UtilityScorer> &node : nodes)
+  {
+    if (usel->utilityNodes.size() == max_utility_children || node.second.inputs.size() > max_utility_inputs)
+    {
+      delete node.first;
+      continue; // TODO: Assert
+    }
+    SlotUtilitySelector::UtilityNode un{node.first, node.second.score, node.second.inputs.size(), {}, {}, 0.f};
+    for (size_t i = 0; i < un.numInputs; ++i)
+    {
+      un.inputSlots[i] = reg_entity_blackboard_var<float>(entity, node.second.inputs[i].c_str());
+      un.inputsSub.subscribe(uint32_t(un.inputSlots[i]));
+    }
+    usel->utilityNodes.push_back(un);
+  }
   return usel;
 }
 
@@ -0,0 +1,309 @@
+#include "behProgram.h"
+#include "behLeaves.h"
+#include <algorithm>
+
+static beh::Node leaf(BehOp op, float param, const char *bb_name)
+{
+  beh::Node node;
+  node.op = op;
+  node.param = param;
+  node.bbName = bb_name ? bb_name : "";
+  return node;
+}
+
+static beh::Node compound(BehOp op, std::vector<beh::Node> children)
+{
+  beh::Node node;
+  node.op = op;
+  node.children = std::move(children);
+  return node;
+}
+
+beh::Node beh::sequence(std::vector<Node> children)
+{
+  return compound(BOP_SEQUENCE, std::move(children));
+}
+
+beh::Node beh::selector(std::vector<Node> children)
+{
+  return compound(BOP_SELECTOR, std::move(children));
+}
+
+beh::Node beh::utility_selector(std::vector<std::pair<Node, UtilityScorer>> children)
+{
+  Node node;
+  node.op = BOP_UTILITY_SELECTOR;
+  if (children.size() > max_utility_children)
+    children.resize(max_utility_children); // TODO: Assert
+  for (std::pair<Node, UtilityScorer> &child : children)
+  {
+    node.children.push_back(std::move(child.first));
+    node.utilities.push_back(std::move(child.second));
+  }
+  return node;
+}
+
+beh::Node beh::move_to_entity(const char *bb_name) { return leaf(BOP_MOVE_TO_ENTITY, 0.f, bb_name); }
+beh::Node beh::is_low_hp(float thres) { return leaf(BOP_IS_LOW_HP, thres, nullptr); }
+beh::Node beh::find_enemy(float dist, const char *bb_name) { return leaf(BOP_FIND_ENEMY, dist, bb_name); }
+beh::Node beh::flee(const char *bb_name) { return leaf(BOP_FLEE, 0.f, bb_name); }
+beh::Node beh::patrol(float patrol_dist, const char *bb_name) { return leaf(BOP_PATROL, patrol_dist, bb_name); }
+beh::Node beh::patch_up(float thres) { return leaf(BOP_PATCH_UP, thres, nullptr); }
+
+// blackboard variable of the leaf
+static uint32_t reg_op_bb_var(BehOp op, const std::string &name)
+{
+  BlackboardSchema &schema = get_blackboard_schema();
+  switch (op)
+  {
+    case BOP_MOVE_TO_ENTITY:
+    case BOP_FIND_ENEMY:
+    case BOP_FLEE:
+      return schema.regKey<flecs::entity>(name).slot;
+    case BOP_PATROL:
+      return schema.regKey<Position>(name).slot;
+    default:
+      return ~0u;
+  }
+}
+
+// sensor written inputs of the leaves, they read the same values from components during the turn
+static bool get_op_sensor_input(BehOp op, BbKey<float> &key)
+{
+  switch (op)
+  {
+    case BOP_IS_LOW_HP:
+    case BOP_PATCH_UP:
+      key = bb_hp;
+      return true;
+    case BOP_FIND_ENEMY:
+      key = bb_enemy_dist;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// returns blackboard slots the subtree depends on
+static BbSlotMask compile_node(BehProgram &prog, const beh::Node &node, uint32_t parent, uint32_t utility)
+{
+  const uint32_t idx = uint32_t(prog.instrs.size());
+  BehInstr instr;
+  instr.op = node.op;
+  instr.parent = parent;
+  instr.param = node.param;
+  instr.utility = utility;
+  BbSlotMask deps;
+  instr.bbSlot = reg_op_bb_var(node.op, node.bbName);
+  if (instr.bbSlot != ~0u)
+    deps.add(instr.bbSlot);
+  BbKey<float> input;
+  if (get_op_sensor_input(node.op, input))
+    deps.add(input.slot);
+  prog.instrs.push_back(instr);
+  for (size_t i = 0; i < node.children.size(); ++i)
+  {
+    uint32_t childUtility = 0;
+    if (node.op == BOP_UTILITY_SELECTOR)
+    {
+      const UtilityScorer &scorer = node.utilities[i];
+      BehUtility utility{scorer.score, uint32_t(std::min(scorer.inputs.size(), max_utility_inputs)), {}};
+      for (uint32_t j = 0; j < utility.numInputs; ++j)
+      {
+        utility.inputSlots[j] = get_blackboard_schema().regKey<float>(scorer.inputs[j]).slot;
+        deps.add(utility.inputSlots[j]);
+      }
+      childUtility = uint32_t(prog.utilities.size());
+      prog.utilities.push_back(utility);
+    }
+    deps |= compile_node(prog, node.children[i], idx, childUtility);
+  }
+  prog.instrs[idx].subtreeEnd = uint32_t(prog.instrs.size());
+  prog.instrs[idx].deps = deps;
+  return deps;
+}
+
+std::shared_ptr<const BehProgram> beh::compile(const Node &root)
+{
+  std::shared_ptr<BehProgram> prog = std::make_shared<BehProgram>();
+  compile_node(*prog, root, 0, 0);
+  return prog;
+}
+
+flecs::entity set_compiled_beh(flecs::entity e, std::shared_ptr<const BehProgram> program, BehTickMode mode)
+{
+  if (!e.has<Blackboard>())
+    e.set(Blackboard{});
+  Blackboard *bb = e.get_mut<Blackboard>();
+  if (!bb)
+    return e; // TODO: Assert
+  for (const BehInstr &instr : program->instrs)
+    if (instr.op == BOP_PATROL)
+      beh::init_patrol(e, *bb, instr.bbSlot);
+  if (mode == BEH_TICK_EVENT_DRIVEN)
+    e.add<WorldInfoGatherer>();
+  return e.set(CompiledBehaviourTree{std::move(program), beh_no_running_node, bb->getVersion(), mode});
+}
+
+static bool is_subtree_dirty(const BehProgram &prog, const Blackboard &bb, uint32_t idx, uint32_t since)
+{
+  return bb.isChanged(prog.instrs[idx].deps, since);
+}
+
+// Earlier siblings on the path to the leaf are the branches a full tick would try first, failed ones of
+// selectors and passed conditions of sequences. They give the same results while their inputs are intact.
+static bool is_running_path_dirty(const BehProgram &prog, const Blackboard &bb, uint32_t leaf, uint32_t since)
+{
+  for (uint32_t node = leaf; node != 0; node = prog.instrs[node].parent)
+  {
+    const uint32_t parent = prog.instrs[node].parent;
+    // any child can win when a score input or a child changes
+    if (prog.instrs[parent].op == BOP_UTILITY_SELECTOR)
+    {
+      if (is_subtree_dirty(prog, bb, parent, since))
+        return true;
+      continue;
+    }
+    for (uint32_t sibling = parent + 1; sibling < node; sibling = prog.instrs[sibling].subtreeEnd)
+      if (is_subtree_dirty(prog, bb, sibling, since))
+        return true;
+  }
+  return false;
+}
+
+struct BehTick
+{
+  const BehProgram &prog;
+  flecs::world &ecs;
+  flecs::entity entity;
+  Blackboard &bb;
+  uint32_t runningNode;
+};
+
+static size_t score_utility_children(const BehTick &t, uint32_t idx, beh::UtilityScore *scores)
+{
+  size_t count = 0;
+  for (uint32_t child = idx + 1; child < t.prog.instrs[idx].subtreeEnd; child = t.prog.instrs[child].subtreeEnd)
+  {
+    const BehUtility &utility = t.prog.utilities[t.prog.instrs[child].utility];
+    float inputs[max_utility_inputs];
+    for (uint32_t i = 0; i < utility.numInputs; ++i)
+      inputs[i] = t.bb.get<float>(utility.inputSlots[i]);
+    scores[count++] = beh::UtilityScore{utility.score(inputs), child};
+  }
+  return count;
+}
+
+static BehResult tick_instr(BehTick &t, uint32_t idx)
+{
+  const BehInstr &instr = t.prog.instrs[idx];
+  BehResult res = BEH_FAIL;
+  switch (instr.op)
+  {
+    case BOP_SEQUENCE:
+      res = BEH_SUCCESS;
+      for (uint32_t child = idx + 1; child < instr.subtreeEnd && res == BEH_SUCCESS;
+           child = t.prog.instrs[child].subtreeEnd)
+        res = tick_instr(t, child);
+      break;
+    case BOP_SELECTOR:
+      for (uint32_t child = idx + 1; child < instr.subtreeEnd && res == BEH_FAIL;
+           child = t.prog.instrs[child].subtreeEnd)
+        res = tick_instr(t, child);
+      break;
+    case BOP_UTILITY_SELECTOR:
+    {
+      beh::UtilityScore utilityScores[max_utility_children];
+      const size_t count = score_utility_children(t, idx, utilityScores);
+      for (size_t i = 0; i < count && res == BEH_FAIL; ++i)
+      {
+        beh::select_next_utility(utilityScores, i, count);
+        res = tick_instr(t, utilityScores[i].child);
+      }
+      break;
+    }
+    case BOP_MOVE_TO_ENTITY:
+      res = beh::tick_move_to_entity(t.entity, t.bb, instr.bbSlot);
+      break;
+    case BOP_IS_LOW_HP:
+      res = beh::tick_is_low_hp(t.entity, instr.param);
+      break;
+    case BOP_FIND_ENEMY:
+      res = beh::tick_find_enemy(t.ecs, t.entity, t.bb, instr.param, instr.bbSlot);
+      break;
+    case BOP_FLEE:
+      res = beh::tick_flee(t.entity, t.bb, instr.bbSlot);
+      break;
+    case BOP_PATROL:
+      res = beh::tick_patrol(t.entity, t.bb, instr.param, instr.bbSlot);
+      break;
+    case BOP_PATCH_UP:
+      res = beh::tick_patch_up(t.entity, instr.param);
+      break;
+    case BOP_NUM:
+      break;
+  }
+  // compounds pass the running result up, the leaf is the first node to report it
+  if (res == BEH_RUNNING && t.runningNode == beh_no_running_node)
+    t.runningNode = idx;
+  return res;
+}
+
+// Completes the tick a full one would make once node returned res. Earlier siblings on the path keep
+// their results while the path isn't dirty, so only the children after node are ticked, up to the root.
+static BehResult resume_after(BehTick &t, uint32_t node, BehResult res)
+{
+  for (; node != 0; node = t.prog.instrs[node].parent)
+  {
+    const uint32_t parent = t.prog.instrs[node].parent;
+    const BehInstr &parentInstr = t.prog.instrs[parent];
+    switch (parentInstr.op)
+    {
+      case BOP_SEQUENCE:
+        for (uint32_t sibling = t.prog.instrs[node].subtreeEnd; sibling < parentInstr.subtreeEnd && res == BEH_SUCCESS;
+             sibling = t.prog.instrs[sibling].subtreeEnd)
+          res = tick_instr(t, sibling);
+        break;
+      case BOP_SELECTOR:
+        for (uint32_t sibling = t.prog.instrs[node].subtreeEnd; sibling < parentInstr.subtreeEnd && res == BEH_FAIL;
+             sibling = t.prog.instrs[sibling].subtreeEnd)
+          res = tick_instr(t, sibling);
+        break;
+      case BOP_UTILITY_SELECTOR:
+      {
+        // scores are unchanged too, children after node in score order are the ones left
+        beh::UtilityScore utilityScores[max_utility_children];
+        const size_t count = score_utility_children(t, parent, utilityScores);
+        bool passed = false;
+        for (size_t i = 0; i < count && res == BEH_FAIL; ++i)
+        {
+          beh::select_next_utility(utilityScores, i, count);
+          if (passed)
+            res = tick_instr(t, utilityScores[i].child);
+          passed |= utilityScores[i].child == node;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  return res;
+}
+
+BehResult update_compiled_beh(flecs::world &ecs, flecs::entity entity, CompiledBehaviourTree &bt, Blackboard &bb)
+{
+  if (!bt.program || bt.program->instrs.empty())
+    return BEH_FAIL;
+  BehTick t{*bt.program, ecs, entity, bb, beh_no_running_node};
+  BehResult res = BEH_FAIL;
+  // the leaf is ticked once, a finished one hands its result to its parent like in a full tick
+  if (bt.mode == BEH_TICK_EVENT_DRIVEN && bt.runningNode != beh_no_running_node &&
+      !is_running_path_dirty(*bt.program, bb, bt.runningNode, bt.bbVersion))
+    res = resume_after(t, bt.runningNode, tick_instr(t, bt.runningNode));
+  else
+    res = tick_instr(t, 0);
+  bt.runningNode = t.runningNode;
+  bt.bbVersion = bb.getVersion();
+  return res;
+}
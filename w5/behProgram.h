@@ -0,0 +1,102 @@
+#pragma once
+#include <flecs.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "aiLibrary.h"
+#include "behaviourTree.h"
+#include "blackboard.h"
+
+enum BehOp : uint8_t
+{
+  BOP_SEQUENCE = 0,
+  BOP_SELECTOR,
+  BOP_UTILITY_SELECTOR,
+  BOP_MOVE_TO_ENTITY,
+  BOP_IS_LOW_HP,
+  BOP_FIND_ENEMY,
+  BOP_FLEE,
+  BOP_PATROL,
+  BOP_PATCH_UP,
+  BOP_NUM
+};
+
+// One node of a compiled tree. Nodes are stored depth first, children follow their parent
+// and subtreeEnd points past the last descendant, so the next sibling is at child.subtreeEnd.
+struct BehInstr
+{
+  BehOp op = BOP_SEQUENCE;
+  uint32_t parent = 0;
+  uint32_t subtreeEnd = 0;
+  uint32_t bbSlot = 0;  // blackboard slot of the leaf
+  uint32_t utility = 0; // scorer of a utility selector child
+  float param = 0.f;
+  // blackboard slots the subtree result depends on, utility scorer inputs included
+  BbSlotMask deps;
+};
+
+struct BehUtility
+{
+  float (*score)(const float *inputs);
+  uint32_t numInputs;
+  uint32_t inputSlots[max_utility_inputs]; // float slots
+};
+
+// Immutable tree shared by every entity running it, blackboard names are resolved to schema slots.
+struct BehProgram
+{
+  std::vector<BehInstr> instrs;
+  std::vector<BehUtility> utilities;
+};
+
+enum BehTickMode : uint8_t
+{
+  BEH_TICK_FULL = 0,    // every tick starts from the root
+  BEH_TICK_EVENT_DRIVEN // resumes the running leaf unless inputs of higher priority branches changed
+};
+
+constexpr uint32_t beh_no_running_node = ~0u;
+
+// Per entity part of a compiled tree, everything else lives in the shared program and the blackboard.
+// Attaching it to an entity allocates nothing but the blackboard storage.
+struct CompiledBehaviourTree
+{
+  std::shared_ptr<const BehProgram> program;
+  uint32_t runningNode = beh_no_running_node; // leaf which returned BEH_RUNNING on the last tick
+  uint32_t bbVersion = 0;                     // blackboard version after the last tick
+  BehTickMode mode = BEH_TICK_FULL;
+};
+
+namespace beh
+{
+  // tree description, it's only used to compile a program
+  struct Node
+  {
+    BehOp op = BOP_SEQUENCE;
+    float param = 0.f;
+    std::string bbName;
+    std::vector<Node> children;
+    std::vector<UtilityScorer> utilities; // per child of a utility selector
+  };
+
+  Node sequence(std::vector<Node> children);
+  Node selector(std::vector<Node> children);
+  // at most max_utility_children children
+  Node utility_selector(std::vector<std::pair<Node, UtilityScorer>> children);
+
+  Node move_to_entity(const char *bb_name);
+  Node is_low_hp(float thres);
+  Node find_enemy(float dist, const char *bb_name);
+  Node flee(const char *bb_name);
+  Node patrol(float patrol_dist, const char *bb_name);
+  Node patch_up(float thres);
+
+  std::shared_ptr<const BehProgram> compile(const Node &root);
+};
+
+// Attaches the tree, the entity gets a blackboard if it has none.
+// Event driven trees read hp and enemyDist from the blackboard, so the entity becomes a WorldInfoGatherer.
+flecs::entity set_compiled_beh(flecs::entity e, std::shared_ptr<const BehProgram> program,
+                               BehTickMode mode = BEH_TICK_FULL);
+BehResult update_compiled_beh(flecs::world &ecs, flecs::entity entity, CompiledBehaviourTree &bt, Blackboard &bb);
@@ -0,0 +1,15 @@
+#include "blackboard.h"
+
+BlackboardSchema::BlackboardSchema()
+{
+  // same order as the constexpr sensor keys
+  regKey<float>("hp");
+  regKey<float>("alliesNum");
+  regKey<float>("enemyDist");
+}
+
+BlackboardSchema &get_blackboard_schema()
+{
+  static BlackboardSchema schema;
+  return schema;
+}
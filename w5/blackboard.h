@@ -3,69 +3,229 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <bit>
 #include <flecs.h>
 #include "ecsTypes.h"
 
 template<typename DataType>
-class NamedDataPool
+struct BbKey
 {
-public:
-  size_t regName(const std::string &name)
+  uint32_t slot = ~0u;
+};
+
+template<typename DataType> struct BbTypeIndex;
+template<> struct BbTypeIndex<float> { static constexpr size_t value = 0; };
+template<> struct BbTypeIndex<int> { static constexpr size_t value = 1; };
+template<> struct BbTypeIndex<flecs::entity> { static constexpr size_t value = 2; };
+template<> struct BbTypeIndex<Position> { static constexpr size_t value = 3; };
+constexpr size_t bb_num_types = 4;
+constexpr size_t bb_max_slots = 128;
+
+// set of schema slots
+struct BbSlotMask
+{
+  uint64_t words[bb_max_slots / 64] = {};
+
+  // slots past bb_max_slots are invalid keys of a full schema, they are never in a mask
+  void add(uint32_t slot)
   {
-    const auto itf = nameIndices.find(name);
-    if (itf != nameIndices.end())
-      return itf->second;
+    if (slot >= bb_max_slots)
+      return; // TODO: Assert
+    words[slot / 64] |= uint64_t(1) << (slot % 64);
+  }
+  bool has(uint32_t slot) const { return slot < bb_max_slots && ((words[slot / 64] >> (slot % 64)) & 1); }
+  void clear() { *this = BbSlotMask{}; }
 
-    size_t idx = data.size();
-    nameIndices.emplace(name, idx);
-    data.emplace_back(DataType());
-    return idx;
+  bool intersects(const BbSlotMask &rhs) const
+  {
+    for (size_t i = 0; i < bb_max_slots / 64; ++i)
+      if (words[i] & rhs.words[i])
+        return true;
+    return false;
   }
 
-  void set(size_t idx, const DataType &in_data)
+  BbSlotMask &operator|=(const BbSlotMask &rhs)
   {
-    data[idx] = in_data;
+    for (size_t i = 0; i < bb_max_slots / 64; ++i)
+      words[i] |= rhs.words[i];
+    return *this;
   }
+};
 
-  DataType get(size_t idx) const
+// Blackboard inputs of one consumer (a tree node, a scorer, transitions of a state) and the
+// blackboard version it was last evaluated at.
+struct BbSubscription
+{
+  BbSlotMask inputs;
+  uint32_t version = 0;
+  bool evaluated = false;
+
+  template<typename DataType>
+  void subscribe(BbKey<DataType> key) { inputs.add(key.slot); }
+  void subscribe(uint32_t slot) { inputs.add(slot); }
+};
+
+// Layout shared by the blackboards of all agents, every name of every type gets a slot at a fixed
+// offset of the agent storage. Names are resolved once, agents only do loads and stores by offset.
+// Keys are registered while building AI, not from parallel phases.
+class BlackboardSchema
+{
+public:
+  BlackboardSchema();
+
+  template<typename DataType>
+  BbKey<DataType> regKey(const std::string &name)
   {
-    return data[idx];
+    static_assert(std::is_trivially_copyable_v<DataType>, "blackboard storage is plain memory");
+    std::unordered_map<std::string, uint32_t> &names = nameSlots[BbTypeIndex<DataType>::value];
+    const auto itf = names.find(name);
+    if (itf != names.end())
+      return BbKey<DataType>{itf->second};
+
+    const uint32_t slot = uint32_t(offsets.size());
+    if (slot >= bb_max_slots)
+      return BbKey<DataType>{}; // TODO: Assert
+    storageSize = (storageSize + alignof(DataType) - 1) / alignof(DataType) * alignof(DataType);
+    offsets.push_back(uint32_t(storageSize));
+    storageSize += sizeof(DataType);
+    names.emplace(name, slot);
+    return BbKey<DataType>{slot};
   }
+
+  uint32_t getOffset(uint32_t slot) const { return offsets[slot]; }
+  size_t getNumSlots() const { return offsets.size(); }
+  size_t getStorageSize() const { return storageSize; }
 private:
-  std::unordered_map<std::string, size_t> nameIndices;
-  std::vector<DataType> data;
+  std::unordered_map<std::string, uint32_t> nameSlots[bb_num_types];
+  std::vector<uint32_t> offsets;
+  size_t storageSize = 0;
 };
 
-class Blackboard : public NamedDataPool<float>,
-                   public NamedDataPool<int>,
-                   public NamedDataPool<flecs::entity>,
-                   public NamedDataPool<Position>
+BlackboardSchema &get_blackboard_schema();
+
+// sensor keys, the schema registers them first so they are known at compile time
+constexpr BbKey<float> bb_hp{0};
+constexpr BbKey<float> bb_allies_num{1};
+constexpr BbKey<float> bb_enemy_dist{2};
+
+// Per agent values of the schema slots in one flat block, slots registered after the block
+// was sized read as zero until they are first set.
+// Every change bumps the slot version and marks the slot dirty until clearDirty, consumers compare
+// their subscriptions against both to skip evaluations when none of their inputs changed.
+class Blackboard
 {
 public:
   template<typename DataType>
   size_t regName(const std::string &name)
   {
-    return NamedDataPool<DataType>::regName(name);
+    return get_blackboard_schema().regKey<DataType>(name).slot;
+  }
+
+  template<typename DataType>
+  void set(BbKey<DataType> key, const DataType &in_data)
+  {
+    set(key.slot, in_data);
+  }
+
+  template<typename DataType>
+  DataType get(BbKey<DataType> key) const
+  {
+    return get<DataType>(key.slot);
   }
 
   template<typename DataType>
   void set(size_t idx, const DataType &in_data)
   {
-    NamedDataPool<DataType>::set(idx, in_data);
+    if (idx >= versions.size())
+    {
+      resize(get_blackboard_schema());
+      if (idx >= versions.size())
+        return; // TODO: Assert
+    }
+    else if (get<DataType>(idx) == in_data)
+      return;
+    memcpy(storage.data() + get_blackboard_schema().getOffset(uint32_t(idx)), &in_data, sizeof(DataType));
+    versions[idx] = ++curVersion;
+    dirty.add(uint32_t(idx));
   }
 
   template<typename DataType>
   DataType get(size_t idx) const
   {
-    return NamedDataPool<DataType>::get(idx);
+    DataType res{};
+    if (idx < versions.size())
+      memcpy(&res, storage.data() + get_blackboard_schema().getOffset(uint32_t(idx)), sizeof(DataType));
+    return res;
+  }
+
+  // version of the last change of the slot, compare with getVersion() taken earlier
+  uint32_t version(size_t idx) const
+  {
+    return idx < versions.size() ? versions[idx] : 0u;
+  }
+
+  template<typename DataType>
+  uint32_t version(size_t idx) const
+  {
+    return version(idx);
+  }
+
+  // bumped by every set which changes a value
+  uint32_t getVersion() const { return curVersion; }
+
+  // slots changed since the last clearDirty
+  const BbSlotMask &getDirty() const { return dirty; }
+  void clearDirty()
+  {
+    dirty.clear();
+    clearedVersion = curVersion;
+  }
+
+  // whether any of the slots changed after the blackboard was at version since
+  bool isChanged(const BbSlotMask &slots, uint32_t since) const
+  {
+    if (curVersion == since)
+      return false;
+    // all changes after the last clear are in the dirty mask, so one mask test covers them
+    if (int32_t(since - clearedVersion) >= 0 && !dirty.intersects(slots))
+      return false;
+    for (size_t i = 0; i < bb_max_slots / 64; ++i)
+      for (uint64_t bits = slots.words[i]; bits != 0; bits &= bits - 1)
+        if (int32_t(version(i * 64 + size_t(std::countr_zero(bits))) - since) > 0)
+          return true;
+    return false;
+  }
+
+  bool needsUpdate(const BbSubscription &sub) const
+  {
+    return !sub.evaluated || isChanged(sub.inputs, sub.version);
+  }
+
+  void markUpdated(BbSubscription &sub) const
+  {
+    sub.version = curVersion;
+    sub.evaluated = true;
   }
 
   // not perf optimized
   template<typename DataType>
   DataType get(const char *name)
   {
-    size_t idx = regName<DataType>(name);
-    return NamedDataPool<DataType>::get(idx);
+    return get<DataType>(regName<DataType>(name));
+  }
+private:
+  void resize(const BlackboardSchema &schema)
+  {
+    storage.resize(schema.getStorageSize(), 0);
+    versions.resize(schema.getNumSlots(), 0u);
   }
-};
 
+  std::vector<uint8_t> storage;
+  std::vector<uint32_t> versions; // blackboard version of the last change per slot
+  BbSlotMask dirty;
+  uint32_t curVersion = 0;
+  uint32_t clearedVersion = 0;
+};
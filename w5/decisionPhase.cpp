@@ -0,0 +1,249 @@
+#include "decisionPhase.h"
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include "ecsTypes.h"
+#include "stateMachine.h"
+#include "behaviourTree.h"
+#include "behProgram.h"
+#include "dmapFollower.h"
+#include "math.h"
+
+// all work of one worker, an agent always lands in the same worker so its decisions keep the serial order
+struct DecisionBatch
+{
+  struct BehTreeAgent
+  {
+    flecs::entity entity;
+    BehaviourTree *bt;
+    Blackboard *bb;
+  };
+  struct CompiledBehTreeAgent
+  {
+    flecs::entity entity;
+    CompiledBehaviourTree *bt;
+    Blackboard *bb;
+  };
+  std::vector<std::pair<flecs::entity, StateMachine*>> stateMachines;
+  std::vector<BehTreeAgent> behTrees;
+  std::vector<CompiledBehTreeAgent> compiledBehTrees;
+  std::vector<flecs::entity> dmapFollowers;
+};
+
+static void run_decision_batch(flecs::world &stage, const DecisionBatch &batch, const DungeonData *dd)
+{
+  for (const std::pair<flecs::entity, StateMachine*> &sm : batch.stateMachines)
+    update_state_machine(stage, sm.first.mut(stage), *sm.second);
+  for (const DecisionBatch::BehTreeAgent &agent : batch.behTrees)
+    agent.bt->update(stage, agent.entity.mut(stage), *agent.bb);
+  for (const DecisionBatch::CompiledBehTreeAgent &agent : batch.compiledBehTrees)
+    update_compiled_beh(stage, agent.entity.mut(stage), *agent.bt, *agent.bb);
+  if (!dd)
+    return;
+  // Action goes through the stage like the writes of other deciders, so it's merged after theirs
+  for (const flecs::entity &e : batch.dmapFollowers)
+    e.mut(stage).insert([&](const Position &pos, Action &act, const DmapWeights &wt)
+    {
+      process_dmap_follower(stage, *dd, pos, act, wt);
+    });
+}
+
+// Everything the phase keeps between turns. Batch 0 runs on the calling thread, worker i runs batch i
+// on stage i. Workers sleep between turns and are woken once per turn, a phase with another thread count
+// starts a new set.
+struct DecisionWorkers
+{
+  // built once, not every turn
+  flecs::query<const Position, const IsPlayer> playerQuery;
+  flecs::query<StateMachine> stateMachineQuery;
+  flecs::query<BehaviourTree, Blackboard> behTreeQuery;
+  flecs::query<CompiledBehaviourTree, Blackboard> compiledBehTreeQuery;
+  flecs::query<const Position, const Action, const DmapWeights> dmapFollowerQuery;
+  flecs::query<const DungeonData> dungeonDataQuery;
+
+  std::vector<DecisionBatch> batches;
+  // AiLod decision of each agent of the turn by entity id, taken once for all of its deciders
+  std::unordered_map<flecs::entity_t, bool> lodTicked;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable startCv;
+  std::condition_variable doneCv;
+  // turn being run, set under the mutex
+  flecs::world *ecs = nullptr;
+  const DungeonData *dd = nullptr;
+  uint64_t turn = 0;
+  size_t numRunning = 0;
+  bool quit = false;
+
+  DecisionWorkers(flecs::world &world, size_t num_threads);
+  ~DecisionWorkers();
+};
+
+static void run_decision_worker(DecisionWorkers &workers, size_t idx)
+{
+  uint64_t lastTurn = 0;
+  std::unique_lock<std::mutex> lock(workers.mutex);
+  while (true)
+  {
+    workers.startCv.wait(lock, [&] { return workers.quit || workers.turn != lastTurn; });
+    if (workers.quit)
+      return;
+    lastTurn = workers.turn;
+    lock.unlock();
+    flecs::world stage = workers.ecs->get_stage(int32_t(idx));
+    run_decision_batch(stage, workers.batches[idx], workers.dd);
+    lock.lock();
+    if (--workers.numRunning == 0)
+      workers.doneCv.notify_one();
+  }
+}
+
+DecisionWorkers::DecisionWorkers(flecs::world &world, size_t num_threads) :
+  playerQuery(world.query<const Position, const IsPlayer>()),
+  stateMachineQuery(world.query<StateMachine>()),
+  behTreeQuery(world.query<BehaviourTree, Blackboard>()),
+  compiledBehTreeQuery(world.query<CompiledBehaviourTree, Blackboard>()),
+  dmapFollowerQuery(world.query<const Position, const Action, const DmapWeights>()),
+  dungeonDataQuery(world.query<const DungeonData>()),
+  batches(num_threads)
+{
+  for (size_t i = 1; i < num_threads; ++i)
+    threads.emplace_back(run_decision_worker, std::ref(*this), i);
+}
+
+DecisionWorkers::~DecisionWorkers()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quit = true;
+  }
+  startCv.notify_all();
+  for (std::thread &thread : threads)
+    thread.join();
+}
+
+static void run_decision_batches(flecs::world &ecs, DecisionWorkers &workers, const DungeonData *dd)
+{
+  {
+    std::lock_guard<std::mutex> lock(workers.mutex);
+    workers.ecs = &ecs;
+    workers.dd = dd;
+    workers.numRunning = workers.threads.size();
+    workers.turn++;
+  }
+  workers.startCv.notify_all();
+  {
+    flecs::world stage = ecs.get_stage(0);
+    run_decision_batch(stage, workers.batches[0], dd);
+  }
+  std::unique_lock<std::mutex> lock(workers.mutex);
+  workers.doneCv.wait(lock, [&] { return workers.numRunning == 0; });
+}
+
+static size_t get_lod_tier(const AiLod &lod, float dist_to_player)
+{
+  for (size_t i = 0; i + 1 < lod.tiers.size(); ++i)
+    if (dist_to_player <= lod.tiers[i].maxDist)
+      return i;
+  return lod.tiers.size() - 1;
+}
+
+static bool is_lod_ticked(const AiLod &lod, size_t tier, flecs::entity e)
+{
+  const uint32_t period = lod.tiers[tier].period;
+  return period != 0 && (e.id() + lod.turn) % period == 0;
+}
+
+void run_decision_phase(flecs::world &ecs)
+{
+  using clock = std::chrono::steady_clock;
+  const auto startTime = clock::now();
+
+  DecisionPhase defaultPhase;
+  DecisionPhase *phase = ecs.get_mut<DecisionPhase>();
+  if (!phase)
+    phase = &defaultPhase;
+  const size_t numThreads = std::clamp(phase->numThreads, size_t(1), size_t(ecs.get_stage_count()));
+  if (!phase->workers || phase->workers->batches.size() != numThreads)
+    phase->workers = std::make_shared<DecisionWorkers>(ecs, numThreads);
+  DecisionWorkers &workers = *phase->workers;
+
+  std::vector<DecisionBatch> &batches = workers.batches;
+  for (DecisionBatch &batch : batches)
+  {
+    batch.stateMachines.clear();
+    batch.behTrees.clear();
+    batch.compiledBehTrees.clear();
+    batch.dmapFollowers.clear();
+  }
+  // by id, so an agent with several deciders gets one worker for all of them
+  auto batchOf = [&](flecs::entity e) -> DecisionBatch& { return batches[e.id() % numThreads]; };
+
+  AiLod *lod = ecs.get_mut<AiLod>();
+  if (lod && lod->tiers.empty())
+    lod = nullptr;
+  bool playerFound = false;
+  Position playerPos;
+  workers.playerQuery.each([&](const Position &pos, const IsPlayer &)
+  {
+    playerPos = pos;
+    playerFound = true;
+  });
+  // an agent is counted in its tier once, when its first decider is batched, so counts match the batches
+  if (lod)
+  {
+    lod->turn++;
+    lod->tierAgents.assign(lod->tiers.size(), 0);
+    lod->tierTicked.assign(lod->tiers.size(), 0);
+  }
+  workers.lodTicked.clear();
+  auto isTicked = [&](flecs::entity e)
+  {
+    const Position *pos = lod ? e.get<Position>() : nullptr;
+    if (!pos)
+      return true;
+    const auto [itf, inserted] = workers.lodTicked.try_emplace(e.id(), true);
+    if (!inserted)
+      return itf->second;
+    const size_t tier = playerFound ? get_lod_tier(*lod, dist(*pos, playerPos)) : 0;
+    itf->second = !playerFound || is_lod_ticked(*lod, tier, e);
+    lod->tierAgents[tier]++;
+    if (itf->second)
+      lod->tierTicked[tier]++;
+    return itf->second;
+  };
+
+  workers.stateMachineQuery.each([&](flecs::entity e, StateMachine &sm)
+  {
+    if (isTicked(e))
+      batchOf(e).stateMachines.emplace_back(e, &sm);
+  });
+  workers.behTreeQuery.each([&](flecs::entity e, BehaviourTree &bt, Blackboard &bb)
+  {
+    if (isTicked(e))
+      batchOf(e).behTrees.push_back(DecisionBatch::BehTreeAgent{e, &bt, &bb});
+  });
+  workers.compiledBehTreeQuery.each([&](flecs::entity e, CompiledBehaviourTree &bt, Blackboard &bb)
+  {
+    if (isTicked(e))
+      batchOf(e).compiledBehTrees.push_back(DecisionBatch::CompiledBehTreeAgent{e, &bt, &bb});
+  });
+  workers.dmapFollowerQuery.each([&](flecs::entity e, const Position &, const Action &, const DmapWeights &)
+  {
+    if (isTicked(e))
+      batchOf(e).dmapFollowers.push_back(e);
+  });
+  const DungeonData *dd = nullptr;
+  workers.dungeonDataQuery.each([&](const DungeonData &data) { dd = &data; });
+
+  // commands of stages are merged in stage order at readonly_end, every entity is touched by one stage only
+  ecs.readonly_begin(numThreads > 1);
+  run_decision_batches(ecs, workers, dd);
+  ecs.readonly_end();
+
+  phase->lastMilliseconds = std::chrono::duration<float, std::milli>(clock::now() - startTime).count();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cfloat>
+#include <vector>
+#include <memory>
+#include <flecs.h>
+
+struct DecisionWorkers;
+
+// World singleton. Agents are split between numThreads workers, each writes through its own flecs stage,
+// so the world needs at least numThreads stages.
+struct DecisionPhase
+{
+  size_t numThreads = 1;
+  float lastMilliseconds = 0.f;
+  // queries, per worker agent batches and the worker threads, kept between turns
+  std::shared_ptr<DecisionWorkers> workers;
+};
+
+struct AiLodTier
+{
+  float maxDist = FLT_MAX; // distance to the player in tiles
+  uint32_t period = 1;     // agents are ticked every period turns, 0 never ticks them and they idle
+};
+
+// World singleton. Agents far from the player run their AI less often, an agent of a tier with period N is
+// ticked on turns where (id + turn) % N == 0, so every turn ticks a similar share of the tier.
+// Tiers go from near to far, agents beyond the last one are in it too.
+struct AiLod
+{
+  std::vector<AiLodTier> tiers = {{8.f, 1}, {20.f, 2}, {40.f, 4}, {FLT_MAX, 16}};
+  uint32_t turn = 0;
+  // agents with a decider per tier and the ones of them ticked, of the last decision phase
+  std::vector<size_t> tierAgents;
+  std::vector<size_t> tierTicked;
+};
+
+// State machines, behaviour trees and dmap followers of all agents. Sensors are read from the blackboards
+// and the sensor index built for the turn, so decisions of an agent only depend on the frozen world and
+// the agent itself, and any number of threads gives the same actions as the serial run.
+// Agents not scheduled by AiLod this turn are skipped.
+void run_decision_phase(flecs::world &ecs);
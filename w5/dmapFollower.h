@@ -1,5 +1,13 @@
 #pragma once
 #include <flecs.h>
 
+struct DungeonData;
+struct Position;
+struct Action;
+struct DmapWeights;
+
 void process_dmap_followers(flecs::world &ecs);
+// one follower, dmaps are looked up by name and only read
+void process_dmap_follower(flecs::world &ecs, const DungeonData &dd, const Position &pos, Action &act,
+                           const DmapWeights &wt);
 
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <cstdint>
 
 // TODO: make a lot of seprate files
 struct Position;
@@ -126,6 +127,12 @@ struct Team
   int team = 0;
 };
 
+// per agent random state, decisions of agents don't depend on the order they are made in
+struct AiRandom
+{
+  uint32_t state = 1;
+};
+
 struct TextureSource {};
 
 struct TurnCounter
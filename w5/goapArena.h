@@ -0,0 +1,61 @@
+#pragma once
+#include <memory_resource>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "goapWorldState.h"
+
+namespace goap
+{
+
+  // Upstream of the search arena, counts what the arena actually takes from the heap
+  class CountingResource : public std::pmr::memory_resource
+  {
+  public:
+    size_t numAllocations = 0;
+    size_t curBytes = 0;
+    size_t peakBytes = 0;
+
+  private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+      numAllocations++;
+      curBytes += bytes;
+      peakBytes = std::max(peakBytes, curBytes);
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+      curBytes -= bytes;
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+  };
+
+  // Per-search monotonic arena: nodes, states and search lists are bump allocated
+  // and released in one shot when the search is destroyed
+  struct PlanArena
+  {
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource resource{16 * 1024, &upstream};
+    size_t numObjects = 0; // nodes and states handed out by the arena
+
+    template<typename T>
+    T *create(const T &val)
+    {
+      numObjects++;
+      return new (resource.allocate(sizeof(T), alignof(T))) T(val);
+    }
+
+    const int8_t *copy_state(const WorldState &st)
+    {
+      numObjects++;
+      int8_t *res = static_cast<int8_t*>(resource.allocate(st.size(), alignof(int8_t)));
+      memcpy(res, st.data(), st.size());
+      return res;
+    }
+  };
+};
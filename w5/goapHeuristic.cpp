@@ -0,0 +1,222 @@
+#include "goapHeuristic.h"
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+static constexpr float inf_cost = std::numeric_limits<float>::infinity();
+
+goap::HeuristicTables goap::build_heuristic_tables(size_t num_states, const std::vector<Action> &actions)
+{
+  HeuristicTables res;
+  res.varCosts.resize(num_states, HeuristicTables::VarCost{{}, inf_cost, inf_cost});
+  res.valueMin.resize(num_states, 0);
+  res.valueMax.resize(num_states, 0);
+  std::vector<bool> valueSeen(num_states, false);
+  std::vector<int> maxStep(num_states, 0);
+
+  auto see_value = [&](size_t var, int val)
+  {
+    res.valueMin[var] = valueSeen[var] ? std::min(res.valueMin[var], val) : val;
+    res.valueMax[var] = valueSeen[var] ? std::max(res.valueMax[var], val) : val;
+    valueSeen[var] = true;
+  };
+
+  for (const Action &action : actions)
+  {
+    HeuristicTables::RelaxedAction ra;
+    ra.cost = action.cost;
+    for (size_t i = 0; i < num_states; ++i)
+    {
+      if (action.precondition[i] >= 0)
+      {
+        ra.precond.emplace_back(i, action.precondition[i]);
+        see_value(i, action.precondition[i]);
+      }
+      if (!action.setBitset[i] && action.effect[i] != 0)
+      {
+        ra.addEffect.emplace_back(i, action.effect[i]);
+        maxStep[i] = std::max(maxStep[i], abs(action.effect[i]));
+      }
+      else if (action.setBitset[i] && action.effect[i] >= 0)
+      {
+        ra.setEffect.emplace_back(i, action.effect[i]);
+        see_value(i, action.effect[i]);
+      }
+    }
+
+    // uniform cost partitioning: every touched variable pays an equal share, so the shares sum up to at most the cost
+    const size_t touched = ra.setEffect.size() + ra.addEffect.size();
+    const float partCost = action.cost / float(std::max(touched, size_t(1)));
+    for (auto [var, val] : ra.setEffect)
+    {
+      auto &setCost = res.varCosts[var].setCost;
+      auto itf = std::find_if(setCost.begin(), setCost.end(), [&](const auto &p) { return p.first == val; });
+      if (itf == setCost.end())
+        setCost.emplace_back(val, partCost);
+      else
+        itf->second = std::min(itf->second, partCost);
+    }
+    for (auto [var, delta] : ra.addEffect)
+    {
+      HeuristicTables::VarCost &vc = res.varCosts[var];
+      if (delta > 0)
+        vc.incUnitCost = std::min(vc.incUnitCost, partCost / float(delta));
+      else
+        vc.decUnitCost = std::min(vc.decUnitCost, partCost / float(-delta));
+    }
+    res.relaxedActions.emplace_back(std::move(ra));
+  }
+
+  for (size_t i = 0; i < num_states; ++i)
+  {
+    res.valueMin[i] -= maxStep[i];
+    res.valueMax[i] += maxStep[i];
+  }
+  return res;
+}
+
+static float delta_heuristic(const goap::WorldState &from, const goap::WorldState &to)
+{
+  float cost = 0;
+  for (size_t i = 0; i < to.size(); ++i)
+    if (to[i] >= 0) // we care about it
+      cost += float(abs(to[i] - from[i]));
+  return cost;
+}
+
+static float unit_cost(const goap::HeuristicTables::VarCost &vc, int from, int to)
+{
+  if (from == to)
+    return 0.f;
+  return to > from ? float(to - from) * vc.incUnitCost : float(from - to) * vc.decUnitCost;
+}
+
+static float min_cost_heuristic(const goap::HeuristicTables &tables, const goap::WorldState &from, const goap::WorldState &to)
+{
+  float cost = 0;
+  for (size_t i = 0; i < to.size(); ++i)
+  {
+    if (to[i] < 0 || to[i] == from[i])
+      continue;
+    const goap::HeuristicTables::VarCost &vc = tables.varCosts[i];
+    // either walk there with additive effects, or set some value and walk from it
+    float varCost = unit_cost(vc, from[i], to[i]);
+    for (auto [val, setCost] : vc.setCost)
+      varCost = std::min(varCost, setCost + unit_cost(vc, val, to[i]));
+    cost += varCost;
+  }
+  return cost;
+}
+
+// Delete relaxation over (variable, value) facts: once a value is reached it stays reachable.
+// Additive effects are explored within the value window, which keeps the fixpoint finite.
+static float relaxed_heuristic(const goap::HeuristicTables &tables, bool use_max,
+                               const goap::WorldState &from, const goap::WorldState &to, goap::HeuristicScratch &scratch)
+{
+  auto combine = [&](float a, float b) { return use_max ? std::max(a, b) : a + b; };
+
+  const size_t numStates = from.size();
+  std::vector<int> &lo = scratch.valueLo;
+  std::vector<int> &hi = scratch.valueHi;
+  std::vector<size_t> &base = scratch.factBase;
+  lo.resize(numStates);
+  hi.resize(numStates);
+  base.assign(numStates + 1, 0);
+  for (size_t i = 0; i < numStates; ++i)
+  {
+    lo[i] = std::min(tables.valueMin[i], int(from[i]));
+    hi[i] = std::max(tables.valueMax[i], int(from[i]));
+    if (to[i] >= 0)
+    {
+      lo[i] = std::min(lo[i], int(to[i]));
+      hi[i] = std::max(hi[i], int(to[i]));
+    }
+    base[i + 1] = base[i] + size_t(hi[i] - lo[i] + 1);
+  }
+  std::vector<float> &factCost = scratch.factCost;
+  factCost.assign(base[numStates], inf_cost);
+  auto in_window = [&](size_t var, int val) { return val >= lo[var] && val <= hi[var]; };
+  auto fact = [&](size_t var, int val) -> float& { return factCost[base[var] + size_t(val - lo[var])]; };
+
+  for (size_t i = 0; i < numStates; ++i)
+    fact(i, from[i]) = 0.f;
+
+  auto relax = [&](size_t var, int val, float cost)
+  {
+    float &cur = fact(var, val);
+    if (cost >= cur)
+      return false;
+    cur = cost;
+    return true;
+  };
+
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (const goap::HeuristicTables::RelaxedAction &ra : tables.relaxedActions)
+    {
+      float preCost = 0.f;
+      for (auto [var, val] : ra.precond)
+        preCost = combine(preCost, fact(var, val));
+      if (preCost == inf_cost)
+        continue;
+      for (auto [var, val] : ra.setEffect)
+        changed |= relax(var, val, preCost + ra.cost);
+      for (auto [var, delta] : ra.addEffect)
+      {
+        auto precIt = std::find_if(ra.precond.begin(), ra.precond.end(), [&](const auto &p) { return p.first == var; });
+        if (precIt != ra.precond.end())
+        {
+          // value is pinned by the precondition, already accounted in preCost
+          const int next = precIt->second + delta;
+          if (in_window(var, next))
+            changed |= relax(var, next, preCost + ra.cost);
+          continue;
+        }
+        for (int val = lo[var]; val <= hi[var]; ++val)
+        {
+          const float valCost = fact(var, val);
+          if (valCost == inf_cost || !in_window(var, val + delta))
+            continue;
+          changed |= relax(var, val + delta, combine(preCost, valCost) + ra.cost);
+        }
+      }
+    }
+  }
+
+  float cost = 0.f;
+  for (size_t i = 0; i < numStates; ++i)
+    if (to[i] >= 0)
+      cost = combine(cost, fact(i, to[i]));
+  return cost;
+}
+
+float goap::eval_heuristic(const HeuristicTables &tables, HeuristicType type, const WorldState &from, const WorldState &to)
+{
+  HeuristicScratch scratch;
+  return eval_heuristic(tables, type, from, to, scratch);
+}
+
+float goap::eval_heuristic(const HeuristicTables &tables, HeuristicType type, const WorldState &from, const WorldState &to,
+                           HeuristicScratch &scratch)
+{
+  switch (type)
+  {
+    case HEUR_MIN_COST: return min_cost_heuristic(tables, from, to);
+    case HEUR_ADD: return relaxed_heuristic(tables, false, from, to, scratch);
+    case HEUR_MAX: return relaxed_heuristic(tables, true, from, to, scratch);
+    default: return delta_heuristic(from, to);
+  }
+}
+
+bool goap::is_heuristic_admissible(HeuristicType type)
+{
+  return type == HEUR_MIN_COST || type == HEUR_MAX;
+}
+
+const char *goap::get_heuristic_name(HeuristicType type)
+{
+  const char *names[HEUR_NUM] = {"delta", "min_cost", "h_add", "h_max"};
+  return type < HEUR_NUM ? names[type] : "unknown";
+}
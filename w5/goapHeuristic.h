@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <utility>
+
+#include "goapWorldState.h"
+#include "goapAction.h"
+
+namespace goap
+{
+
+  enum HeuristicType
+  {
+    HEUR_DELTA = 0, // sum of |delta| over cared variables, not admissible
+    HEUR_MIN_COST,  // per-variable minimum cost table with uniform cost partitioning, admissible
+    HEUR_ADD,       // relaxed plan, sum over goal facts, not admissible but well informed
+    HEUR_MAX,       // relaxed plan, max over goal facts, admissible
+    HEUR_NUM
+  };
+
+  // Precomputed once per planner (see add_action_to_planner), evaluated per search node
+  struct HeuristicTables
+  {
+    struct VarCost
+    {
+      std::vector<std::pair<int8_t, float>> setCost; // value -> min (partitioned) cost of action setting it
+      float incUnitCost; // min (partitioned) cost of +1 from additive effects
+      float decUnitCost; // min (partitioned) cost of -1 from additive effects
+    };
+
+    struct RelaxedAction
+    {
+      float cost = 1.f;
+      std::vector<std::pair<size_t, int8_t>> precond;
+      std::vector<std::pair<size_t, int8_t>> setEffect;
+      std::vector<std::pair<size_t, int8_t>> addEffect;
+    };
+
+    std::vector<VarCost> varCosts;
+    std::vector<RelaxedAction> relaxedActions;
+    // value window of each variable for relaxed reachability, widened by the largest additive step
+    std::vector<int> valueMin;
+    std::vector<int> valueMax;
+  };
+
+  // buffers of the relaxed heuristics, keep one around to evaluate without allocations
+  struct HeuristicScratch
+  {
+    std::vector<int> valueLo;
+    std::vector<int> valueHi;
+    std::vector<size_t> factBase;
+    std::vector<float> factCost;
+  };
+
+  HeuristicTables build_heuristic_tables(size_t num_states, const std::vector<Action> &actions);
+
+  float eval_heuristic(const HeuristicTables &tables, HeuristicType type, const WorldState &from, const WorldState &to);
+  float eval_heuristic(const HeuristicTables &tables, HeuristicType type, const WorldState &from, const WorldState &to,
+                       HeuristicScratch &scratch);
+  bool is_heuristic_admissible(HeuristicType type);
+  const char *get_heuristic_name(HeuristicType type);
+};
@@ -0,0 +1,148 @@
+#include "goapHtn.h"
+
+static constexpr size_t max_decomposition_depth = 64;
+
+goap::HtnDomain goap::create_htn_domain(const Planner &planner)
+{
+  HtnDomain res;
+  res.planner = &planner;
+  return res;
+}
+
+static void add_task(goap::HtnDomain &domain, goap::HtnTask &&task)
+{
+  domain.taskNames.emplace(task.name, domain.tasks.size());
+  domain.tasks.emplace_back(std::move(task));
+}
+
+void goap::add_primitive_task(HtnDomain &domain, const char *action_name)
+{
+  auto itf = domain.planner->actionNames.find(action_name);
+  if (itf == domain.planner->actionNames.end())
+    return; // TODO: Assert
+  HtnTask task;
+  task.name = action_name;
+  task.type = HTN_PRIMITIVE;
+  task.action = itf->second;
+  add_task(domain, std::move(task));
+}
+
+void goap::add_compound_task(HtnDomain &domain, const char *name)
+{
+  HtnTask task;
+  task.name = name;
+  task.type = HTN_COMPOUND;
+  add_task(domain, std::move(task));
+}
+
+void goap::add_goal_task(HtnDomain &domain, const char *name, const WorldStateList &goal)
+{
+  HtnTask task;
+  task.name = name;
+  task.type = HTN_GOAL;
+  task.goal = produce_planner_worldstate(*domain.planner, goal);
+  add_task(domain, std::move(task));
+}
+
+void goap::add_method_to_task(HtnDomain &domain, const char *task_name, const char *method_name, const WorldStateList &precond,
+                              const std::vector<std::string> &subtasks)
+{
+  auto itf = domain.taskNames.find(task_name);
+  if (itf == domain.taskNames.end() || domain.tasks[itf->second].type != HTN_COMPOUND)
+    return; // TODO: Assert
+  HtnMethod method;
+  method.name = method_name;
+  method.precondition = produce_planner_worldstate(*domain.planner, precond);
+  for (const std::string &subtask : subtasks)
+  {
+    auto subIt = domain.taskNames.find(subtask);
+    if (subIt == domain.taskNames.end())
+      return; // TODO: Assert
+    method.subtasks.push_back(subIt->second);
+  }
+  domain.tasks[itf->second].methods.emplace_back(std::move(method));
+}
+
+// Depth first total order decomposition, state is simulated forward with planner actions.
+// On failure state, plan and cost are left as they were so the caller can try the next method.
+static bool decompose_task(const goap::HtnDomain &domain, size_t task_id, goap::WorldState &state,
+                           std::vector<goap::PlanStep> &plan, float &cost, const goap::PlanParams &params,
+                           goap::HtnStats &stats, size_t depth)
+{
+  if (depth > max_decomposition_depth)
+    return false;
+  const goap::Planner &planner = *domain.planner;
+  const goap::HtnTask &task = domain.tasks[task_id];
+  stats.decomposedTasks++;
+  switch (task.type)
+  {
+    case goap::HTN_PRIMITIVE:
+    {
+      if (!goap::is_action_applicable(planner, task.action, state))
+        return false;
+      state = goap::apply_action(planner, task.action, state);
+      plan.push_back({task.action, state});
+      cost += goap::get_action_cost(planner, task.action);
+      return true;
+    }
+    case goap::HTN_GOAL:
+    {
+      // search is constrained to the sub-goal, which keeps it shallow
+      goap::PlanSearch search = goap::create_plan_search(planner, state, task.goal, params);
+      goap::step_plan_search(search, goap::PlanBudget{});
+      stats.goalSearches++;
+      stats.goalSearchNodes += search.stats.expandedNodes;
+      if (search.status != goap::PLAN_FOUND)
+        return false;
+      std::vector<goap::PlanStep> subPlan;
+      cost += goap::get_plan_search_result(search, subPlan);
+      if (!subPlan.empty())
+        state = subPlan.back().worldState;
+      plan.insert(plan.end(), subPlan.begin(), subPlan.end());
+      return true;
+    }
+    case goap::HTN_COMPOUND:
+    {
+      for (const goap::HtnMethod &method : task.methods)
+      {
+        if (!goap::is_goal_reached(state, method.precondition))
+          continue;
+        const goap::WorldState savedState = state;
+        const size_t savedPlanSize = plan.size();
+        const float savedCost = cost;
+        bool decomposed = true;
+        for (size_t subtask : method.subtasks)
+          if (!decompose_task(domain, subtask, state, plan, cost, params, stats, depth + 1))
+          {
+            decomposed = false;
+            break;
+          }
+        if (decomposed)
+          return true;
+        state = savedState;
+        plan.resize(savedPlanSize);
+        cost = savedCost;
+        stats.backtracks++;
+      }
+      return false;
+    }
+  }
+  return false;
+}
+
+float goap::make_htn_plan(const HtnDomain &domain, const WorldState &from, const char *root_task, std::vector<PlanStep> &plan,
+                          const PlanParams &goal_params, HtnStats *stats)
+{
+  HtnStats localStats;
+  HtnStats &htnStats = stats ? *stats : localStats;
+  htnStats = HtnStats{};
+
+  auto itf = domain.taskNames.find(root_task);
+  if (itf == domain.taskNames.end())
+    return 0.f;
+  WorldState state = from;
+  float cost = 0.f;
+  if (!decompose_task(domain, itf->second, state, plan, cost, goal_params, htnStats, 0))
+    return 0.f;
+  return cost;
+}
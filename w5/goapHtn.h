@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "goapPlanner.h"
+
+namespace goap
+{
+
+  enum HtnTaskType
+  {
+    HTN_PRIMITIVE = 0, // single planner action
+    HTN_COMPOUND,      // decomposed by the first method whose precondition holds
+    HTN_GOAL           // sub-goal solved by regular GOAP search from the current state
+  };
+
+  struct HtnMethod
+  {
+    std::string name;
+    WorldState precondition;
+    std::vector<size_t> subtasks;
+  };
+
+  struct HtnTask
+  {
+    std::string name;
+    HtnTaskType type = HTN_PRIMITIVE;
+    size_t action = size_t(-1);     // primitive
+    std::vector<HtnMethod> methods; // compound, in priority order
+    WorldState goal;                // goal
+  };
+
+  // Tasks are layered on top of a planner and share its world state and actions
+  struct HtnDomain
+  {
+    const Planner *planner = nullptr;
+    std::vector<HtnTask> tasks;
+    std::unordered_map<std::string, size_t> taskNames;
+  };
+
+  struct HtnStats
+  {
+    size_t decomposedTasks = 0;
+    size_t backtracks = 0;
+    size_t goalSearches = 0;
+    size_t goalSearchNodes = 0; // nodes expanded by all GOAP sub-searches
+  };
+
+  HtnDomain create_htn_domain(const Planner &planner);
+
+  void add_primitive_task(HtnDomain &domain, const char *action_name);
+  void add_compound_task(HtnDomain &domain, const char *name);
+  void add_goal_task(HtnDomain &domain, const char *name, const WorldStateList &goal);
+  // subtasks have to be added before the method, compound task itself can be referenced for recursion
+  void add_method_to_task(HtnDomain &domain, const char *task_name, const char *method_name, const WorldStateList &precond,
+                          const std::vector<std::string> &subtasks);
+
+  // returns plan cost, plan is left empty if the task can't be decomposed from this state
+  float make_htn_plan(const HtnDomain &domain, const WorldState &from, const char *root_task, std::vector<PlanStep> &plan,
+                      const PlanParams &goal_params = {}, HtnStats *stats = nullptr);
+};
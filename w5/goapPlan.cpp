@@ -1,90 +1,231 @@
 #include "goapPlanner.h"
 #include <algorithm>
+#include <limits>
+#include <chrono>
+#include <cstring>
 
-struct PlanNode
+bool goap::is_goal_reached(const WorldState &from, const WorldState &to)
 {
-  goap::WorldState worldState;
-  goap::WorldState prevState;
-  float prevG;
+  for (size_t i = 0; i < to.size(); ++i)
+    if (to[i] >= 0 && to[i] != from[i])
+      return false;
+  return true;
+}
 
-  float g = 0;
-  float h = 0;
+static void reconstruct_plan(const goap::PlanNode *goal_node, size_t state_size, std::vector<goap::PlanStep> &plan)
+{
+  for (const goap::PlanNode *node = goal_node; node->actionId != size_t(-1); node = node->parent)
+    plan.push_back({node->actionId, goap::WorldState(node->state, node->state + state_size)});
+  std::reverse(plan.begin(), plan.end());
+}
 
-  size_t actionId;
-};
+// forward search works on full states towards a partial goal,
+// regression works on partial states towards any one satisfied by the start state
+static void search_transitions(goap::PlanSearch &search, const goap::WorldState &st)
+{
+  if (search.stats.direction != goap::SEARCH_BACKWARD)
+  {
+    goap::find_valid_state_transitions(*search.planner, st, search.transitions);
+    return;
+  }
+  search.transitions.clear();
+  for (size_t i = 0; i < search.planner->actions.size(); ++i)
+    if (goap::regress_action(*search.planner, i, st, search.nextState) && search.nextState != st)
+      search.transitions.emplace_back(i);
+}
 
-static float heuristic(const goap::WorldState &from, const goap::WorldState &to)
+static void search_successor(goap::PlanSearch &search, size_t act, const goap::WorldState &st, goap::WorldState &res)
 {
-  float cost = 0;
-  for (size_t i = 0; i < to.size(); ++i)
-    if (to[i] >= 0) // we care about it
-      cost += float(abs(to[i] - from[i]));
-  return cost;
+  if (search.stats.direction == goap::SEARCH_BACKWARD)
+    goap::regress_action(*search.planner, act, st, res);
+  else
+    goap::apply_action(*search.planner, act, st, res);
+}
+
+static bool search_goal_reached(const goap::PlanSearch &search, const goap::WorldState &st)
+{
+  if (search.stats.direction == goap::SEARCH_BACKWARD)
+    return goap::is_goal_reached(search.from, st);
+  return goap::is_goal_reached(st, search.to);
+}
+
+static float search_heuristic(goap::PlanSearch &search, const goap::WorldState &st)
+{
+  const goap::HeuristicTables &tables = search.planner->heuristics;
+  if (search.stats.direction == goap::SEARCH_BACKWARD)
+    return goap::eval_heuristic(tables, search.params.heuristic, search.from, st, search.heuristicScratch);
+  return goap::eval_heuristic(tables, search.params.heuristic, st, search.to, search.heuristicScratch);
 }
 
-static void reconstruct_plan(PlanNode &goal_node, const std::vector<PlanNode> &closed, std::vector<goap::PlanStep> &plan)
+// mean number of successors over the first two layers of the search
+static float measure_branching(goap::PlanSearch &search, goap::SearchDirection dir, const goap::WorldState &root)
 {
-  PlanNode &curNode = goal_node;
-  while (curNode.actionId != size_t(-1))
+  search.stats.direction = dir;
+  search_transitions(search, root);
+  const std::vector<size_t> rootTransitions = search.transitions;
+  size_t numSuccessors = rootTransitions.size();
+  for (size_t actId : rootTransitions)
   {
-    plan.push_back({curNode.actionId, curNode.worldState});
-    auto itf = std::find_if(closed.begin(), closed.end(), [&](const PlanNode &n) { return n.worldState == curNode.prevState && n.g == curNode.prevG; });
-    curNode = *itf;
+    search_successor(search, actId, root, search.curState);
+    search_transitions(search, search.curState);
+    numSuccessors += search.transitions.size();
   }
-  std::reverse(plan.begin(), plan.end());
+  return float(numSuccessors) / float(1 + rootTransitions.size());
+}
+
+static void update_arena_stats(goap::PlanSearch &search)
+{
+  search.stats.arenaObjects = search.arena->numObjects;
+  search.stats.heapAllocations = search.arena->upstream.numAllocations;
+  search.stats.peakMemory = search.arena->upstream.peakBytes;
+}
+
+goap::PlanSearch goap::create_plan_search(const Planner &planner, const WorldState &from, const WorldState &to,
+                                          const PlanParams &params)
+{
+  PlanSearch search;
+  search.planner = &planner;
+  search.from = from;
+  search.to = to;
+  search.params = params;
+  search.stats.suboptimalityBound = is_heuristic_admissible(params.heuristic) ? std::max(params.weight, 1.f)
+                                                                              : std::numeric_limits<float>::infinity();
+  search.stats.direction = params.direction;
+  if (params.direction == SEARCH_AUTO)
+  {
+    search.stats.forwardBranching = measure_branching(search, SEARCH_FORWARD, from);
+    search.stats.backwardBranching = measure_branching(search, SEARCH_BACKWARD, to);
+    search.stats.direction = search.stats.backwardBranching < search.stats.forwardBranching ? SEARCH_BACKWARD
+                                                                                            : SEARCH_FORWARD;
+  }
+  const WorldState &root = search.stats.direction == SEARCH_BACKWARD ? to : from;
+  search.openList.push_back(search.arena->create(PlanNode{search.arena->copy_state(root), nullptr, 0.f,
+                                                          search_heuristic(search, root), size_t(-1)}));
+  update_arena_stats(search);
+  return search;
 }
 
-float goap::make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan)
+goap::PlanStatus goap::step_plan_search(PlanSearch &search, const PlanBudget &budget)
 {
-  std::vector<PlanNode> openList = {PlanNode{from, from, -1, 0, heuristic(from, to), size_t(-1)}};
-  std::vector<PlanNode> closedList = {};
-  while (!openList.empty())
+  using clock = std::chrono::steady_clock;
+  const clock::time_point startTime = clock::now();
+  auto f_score = [&](const PlanNode *n) { return n->g + search.params.weight * n->h; };
+
+  const size_t stateSize = search.planner->wdesc.size();
+  auto same_state = [&](const PlanNode *n, const WorldState &st) { return memcmp(n->state, st.data(), stateSize) == 0; };
+
+  std::pmr::vector<PlanNode*> &openList = search.openList;
+  std::pmr::vector<PlanNode*> &closedList = search.closedList;
+  PlanStats &stats = search.stats;
+  WorldState &curState = search.curState;
+  WorldState &nextState = search.nextState;
+  size_t numExpanded = 0;
+  while (search.status == PLAN_IN_PROGRESS)
   {
+    if (openList.empty())
+    {
+      search.status = PLAN_FAILED;
+      break;
+    }
+    if (budget.maxNodes > 0 && numExpanded >= budget.maxNodes)
+      break;
+    if (budget.maxMicroseconds > 0.f &&
+        std::chrono::duration<float, std::micro>(clock::now() - startTime).count() >= budget.maxMicroseconds)
+      break;
+
     auto minIt = openList.begin();
-    float minF = minIt->g + minIt->h;
+    float minF = f_score(*minIt);
     for (auto it = openList.begin(); it != openList.end(); ++it)
-      if (it->g + it->h < minF)
+      if (f_score(*it) < minF)
       {
-        minF = it->g + it->h;
+        minF = f_score(*it);
         minIt = it;
       }
-    PlanNode cur = *minIt;
+    PlanNode *cur = *minIt;
     openList.erase(minIt);
-    if (heuristic(cur.worldState, to) == 0) // we've reached our goal
+    curState.assign(cur->state, cur->state + stateSize);
+    if (search_goal_reached(search, curState))
     {
-      reconstruct_plan(cur, closedList, plan);
-      return minF;
+      stats.cost = cur->g;
+      search.goalNode = cur;
+      search.status = PLAN_FOUND;
+      break;
     }
     closedList.push_back(cur);
-    std::vector<size_t> transitions = find_valid_state_transitions(planner, cur.worldState);
-    //const bool firstIter = openList.empty();
-    //printf("------------\n");
-    for (size_t actId : transitions)
+    if (!search.bestNode || cur->h < search.bestNode->h || (cur->h == search.bestNode->h && cur->g < search.bestNode->g))
+      search.bestNode = cur;
+    stats.expandedNodes++;
+    numExpanded++;
+    search_transitions(search, curState);
+    for (size_t actId : search.transitions)
     {
-      //printf("valid action: %s\n", planner.actions[actId].name.c_str());
-      WorldState st = apply_action(planner, actId, cur.worldState);
-      const float score = cur.g + get_action_cost(planner, actId);
-      auto openIt = std::find_if(openList.begin(), openList.end(), [&](const PlanNode &n) { return st == n.worldState; });
-      auto closeIt = std::find_if(closedList.begin(), closedList.end(), [&](const PlanNode &n) { return st == n.worldState; });
-      if (openIt != openList.end() && score < openIt->g)
+      search_successor(search, actId, curState, nextState);
+      const float score = cur->g + get_action_cost(*search.planner, actId);
+      auto openIt = std::find_if(openList.begin(), openList.end(), [&](const PlanNode *n) { return same_state(n, nextState); });
+      auto closeIt = std::find_if(closedList.begin(), closedList.end(), [&](const PlanNode *n) { return same_state(n, nextState); });
+      if (openIt != openList.end() && score < (*openIt)->g)
       {
-        openIt->g = score;
-        openIt->prevState = cur.worldState;
-        openIt->prevG = cur.g;
-        openIt->h = heuristic(st, to);
+        (*openIt)->g = score;
+        (*openIt)->parent = cur;
+        (*openIt)->actionId = actId;
       }
-      if (closeIt != closedList.end() && score < closeIt->g)
+      if (closeIt != closedList.end() && score < (*closeIt)->g)
       {
-        closeIt->g = score;
-        closeIt->prevState = cur.worldState;
-        closeIt->prevG = cur.g;
-        closeIt->h = heuristic(st, to);
+        (*closeIt)->g = score;
+        (*closeIt)->parent = cur;
+        (*closeIt)->actionId = actId;
       }
       if (closeIt == closedList.end() && openIt == openList.end())
-        openList.push_back({st, cur.worldState, cur.g, score, heuristic(st, to), actId});
+      {
+        const float h = search_heuristic(search, nextState);
+        if (h == std::numeric_limits<float>::infinity())
+          continue; // goal is unreachable even in relaxed problem, dead end
+        openList.push_back(search.arena->create(PlanNode{search.arena->copy_state(nextState), cur, score, h, actId}));
+        stats.generatedNodes++;
+      }
     }
   }
-  return 0.f;
+  update_arena_stats(search);
+  return search.status;
+}
+
+float goap::get_plan_search_result(const PlanSearch &search, std::vector<PlanStep> &plan)
+{
+  const size_t stateSize = search.planner->wdesc.size();
+  if (search.status != PLAN_FOUND)
+  {
+    if (search.stats.direction == SEARCH_BACKWARD || !search.bestNode)
+      return 0.f;
+    reconstruct_plan(search.bestNode, stateSize, plan);
+    return search.bestNode->g;
+  }
+  if (search.stats.direction != SEARCH_BACKWARD)
+  {
+    reconstruct_plan(search.goalNode, stateSize, plan);
+    return search.stats.cost;
+  }
+  // regression yields actions from the last one to the first one, replay them forward to get full states
+  std::vector<PlanStep> regression;
+  reconstruct_plan(search.goalNode, stateSize, regression);
+  WorldState st = search.from;
+  for (auto it = regression.rbegin(); it != regression.rend(); ++it)
+  {
+    st = apply_action(*search.planner, it->action, st);
+    plan.push_back({it->action, st});
+  }
+  return search.stats.cost;
+}
+
+float goap::make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan,
+                      const PlanParams &params, PlanStats *stats)
+{
+  PlanSearch search = create_plan_search(planner, from, to, params);
+  step_plan_search(search, PlanBudget{});
+  if (stats)
+    *stats = search.stats;
+  if (search.status != PLAN_FOUND)
+    return 0.f;
+  return get_plan_search_result(search, plan);
 }
 
 void goap::print_plan(const Planner &planner, const WorldState &init, const std::vector<PlanStep> &plan)
@@ -1,4 +1,5 @@
 #include "goapPlanner.h"
+#include <cstdint>
 
 goap::Planner goap::create_planner()
 {
@@ -9,6 +10,7 @@ void goap::add_states_to_planner(Planner &planner, const std::vector<std::string
 {
   for (const std::string &name : state_names)
     planner.wdesc.emplace(name, planner.wdesc.size());
+  planner.heuristics = build_heuristic_tables(planner.wdesc.size(), planner.actions);
 }
 
 
@@ -26,6 +28,7 @@ void goap::add_action_to_planner(Planner &planner, const char *name, float cost,
 
   planner.actionNames.emplace(name, planner.actions.size());
   planner.actions.emplace_back(act);
+  planner.heuristics = build_heuristic_tables(planner.wdesc.size(), planner.actions);
 }
 
 static void set_planner_worldstate(const goap::Planner &planner, goap::WorldState &st, const char *st_name, int8_t val)
@@ -61,26 +64,59 @@ static bool not_eq_states(const goap::WorldState& lhs, const goap::WorldState& r
   return false;
 }
 
+static bool is_action_valid(const goap::Action &action, const goap::WorldState &from)
+{
+  for (size_t j = 0; j < action.precondition.size(); ++j)
+    if (action.precondition[j] >= 0 && from[j] != action.precondition[j])
+      return false;
+  return true;
+}
+
+static bool is_action_changing_state(const goap::Action &action, const goap::WorldState &from)
+{
+  for (size_t i = 0; i < action.effect.size(); ++i)
+  {
+    if (!action.setBitset[i] && action.effect[i] != 0)
+      return true;
+    if (action.setBitset[i] && action.effect[i] >= 0 && from[i] != action.effect[i])
+      return true;
+  }
+  return false;
+}
+
+bool goap::is_action_applicable(const Planner &planner, size_t act, const WorldState &from)
+{
+  return is_action_valid(planner.actions[act], from);
+}
+
 std::vector<size_t> goap::find_valid_state_transitions(const Planner &planner, const WorldState &from)
 {
   std::vector<size_t> res;
+  find_valid_state_transitions(planner, from, res);
+  return res;
+}
 
+void goap::find_valid_state_transitions(const Planner &planner, const WorldState &from, std::vector<size_t> &res)
+{
+  res.clear();
   for (size_t i = 0; i < planner.actions.size(); ++i)
   {
     const Action &action = planner.actions[i];
-    bool isValidAction = true;
-    for (size_t j = 0; j < action.precondition.size() && isValidAction; ++j)
-      isValidAction &= action.precondition[j] < 0 || from[j] == action.precondition[j];
-    WorldState newWs = apply_action(planner, i, from);
-    if (isValidAction && not_eq_states(newWs, from))
+    if (is_action_valid(action, from) && is_action_changing_state(action, from))
       res.emplace_back(i);
   }
-  return res;
 }
 
 goap::WorldState goap::apply_action(const Planner &planner, size_t act, const WorldState &from)
 {
-  WorldState res = from;
+  WorldState res;
+  apply_action(planner, act, from, res);
+  return res;
+}
+
+void goap::apply_action(const Planner &planner, size_t act, const WorldState &from, WorldState &res)
+{
+  res = from;
   const Action &action = planner.actions[act];
   for (size_t i = 0; i < action.effect.size(); ++i)
   {
@@ -89,6 +125,55 @@ goap::WorldState goap::apply_action(const Planner &planner, size_t act, const Wo
     else if (action.effect[i] >= 0)
       res[i] = action.effect[i];
   }
+}
+
+std::vector<size_t> goap::find_relevant_actions(const Planner &planner, const WorldState &goal)
+{
+  std::vector<size_t> res;
+  WorldState regressed;
+  for (size_t i = 0; i < planner.actions.size(); ++i)
+    if (regress_action(planner, i, goal, regressed) && not_eq_states(regressed, goal))
+      res.emplace_back(i);
   return res;
 }
 
+bool goap::regress_action(const Planner &planner, size_t act, const WorldState &goal, WorldState &res)
+{
+  res = goal;
+  const Action &action = planner.actions[act];
+  bool contributes = false;
+  for (size_t i = 0; i < goal.size(); ++i)
+  {
+    if (goal[i] < 0) // we don't care what action does with it
+      continue;
+    if (!action.setBitset[i])
+    {
+      if (action.effect[i] == 0)
+        continue;
+      const int prevVal = goal[i] - action.effect[i];
+      if (prevVal < 0 || prevVal > INT8_MAX)
+        return false; // negative values are reserved for "don't care"
+      res[i] = int8_t(prevVal);
+      contributes = true;
+    }
+    else if (action.effect[i] >= 0)
+    {
+      if (action.effect[i] != goal[i])
+        return false; // action overwrites the value we need
+      res[i] = -1;
+      contributes = true;
+    }
+  }
+  if (!contributes)
+    return false;
+  for (size_t i = 0; i < goal.size(); ++i)
+  {
+    const int8_t pre = action.precondition[i];
+    if (pre < 0)
+      continue;
+    if (res[i] >= 0 && res[i] != pre)
+      return false;
+    res[i] = pre;
+  }
+  return true;
+}
@@ -5,6 +5,9 @@
 
 #include "goapWorldState.h"
 #include "goapAction.h"
+#include "goapHeuristic.h"
+#include "goapArena.h"
+#include <memory>
 
 namespace goap
 {
@@ -14,6 +17,7 @@ namespace goap
     WorldDesc wdesc;
     std::vector<Action> actions;
     std::unordered_map<std::string, size_t> actionNames;
+    HeuristicTables heuristics; // rebuilt whenever states or actions are added
   };
 
   Planner create_planner();
@@ -32,8 +36,16 @@ namespace goap
 
   float get_action_cost(const Planner &planner, size_t act_id);
 
+  bool is_action_applicable(const Planner &planner, size_t act, const WorldState &from);
   std::vector<size_t> find_valid_state_transitions(const Planner &planner, const WorldState &from);
   WorldState apply_action(const Planner &planner, size_t act, const WorldState &from);
+  // same as above, but write into existing buffers to avoid allocating in the search loop
+  void find_valid_state_transitions(const Planner &planner, const WorldState &from, std::vector<size_t> &res);
+  void apply_action(const Planner &planner, size_t act, const WorldState &from, WorldState &res);
+
+  // regression: partial states (-1 is "don't care") that must hold before the action to reach the goal after it
+  std::vector<size_t> find_relevant_actions(const Planner &planner, const WorldState &goal);
+  bool regress_action(const Planner &planner, size_t act, const WorldState &goal, WorldState &res);
 
   struct PlanStep
   {
@@ -41,7 +53,97 @@ namespace goap
     WorldState worldState;
   };
 
-  float make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan);
+  enum SearchDirection
+  {
+    SEARCH_FORWARD = 0,
+    SEARCH_BACKWARD, // goal regression
+    SEARCH_AUTO      // picks the direction with the smaller measured branching
+  };
+
+  struct PlanParams
+  {
+    HeuristicType heuristic = HEUR_DELTA;
+    SearchDirection direction = SEARCH_FORWARD;
+    float weight = 1.f; // weighted A*: f = g + weight * h
+  };
+
+  struct PlanStats
+  {
+    size_t expandedNodes = 0;
+    size_t generatedNodes = 0;
+    float cost = 0.f;
+    float suboptimalityBound = 1.f; // cost <= bound * optimal cost, inf if the heuristic is not admissible
+    SearchDirection direction = SEARCH_FORWARD; // direction actually used
+    float forwardBranching = 0.f;  // measured only for SEARCH_AUTO
+    float backwardBranching = 0.f;
+    size_t arenaObjects = 0;      // nodes and states allocated from the search arena
+    size_t heapAllocations = 0;   // blocks the arena requested from the heap
+    size_t peakMemory = 0;        // peak bytes held by the arena
+  };
+
+  bool is_goal_reached(const WorldState &from, const WorldState &to);
+  float make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan,
+                  const PlanParams &params = {}, PlanStats *stats = nullptr);
+
+  enum PlanStatus
+  {
+    PLAN_IN_PROGRESS = 0,
+    PLAN_FOUND,
+    PLAN_FAILED
+  };
+
+  struct PlanBudget
+  {
+    size_t maxNodes = 0;          // node expansions per step, 0 - unlimited
+    float maxMicroseconds = 0.f;  // wall time per step, 0 - unlimited
+  };
+
+  struct PlanNode
+  {
+    const int8_t *state = nullptr; // lives in the search arena, planner.wdesc.size() values
+    const PlanNode *parent = nullptr;
+
+    float g = 0;
+    float h = 0;
+
+    size_t actionId = size_t(-1);
+  };
+
+  // Resumable search, open and closed lists survive between steps so it can be sliced across frames
+  struct PlanSearch
+  {
+    std::unique_ptr<PlanArena> arena = std::make_unique<PlanArena>(); // declared first, outlives the lists
+
+    PlanSearch() = default;
+    // the arena is heap allocated, moved lists keep pointing at the same resource
+    PlanSearch(PlanSearch &&) = default;
+    // would free the old arena before the old lists release their buffers into it
+    PlanSearch &operator=(PlanSearch &&) = delete;
+
+    const Planner *planner = nullptr;
+    WorldState from;
+    WorldState to;
+    PlanParams params;
+    PlanStats stats;
+    PlanStatus status = PLAN_IN_PROGRESS;
+
+    std::pmr::vector<PlanNode*> openList{&arena->resource};
+    std::pmr::vector<PlanNode*> closedList{&arena->resource};
+    const PlanNode *goalNode = nullptr;
+    const PlanNode *bestNode = nullptr; // closed node with the lowest h, tail of the best partial plan
+
+    // scratch buffers reused by every expansion
+    WorldState curState;
+    WorldState nextState;
+    std::vector<size_t> transitions;
+    HeuristicScratch heuristicScratch;
+  };
+
+  PlanSearch create_plan_search(const Planner &planner, const WorldState &from, const WorldState &to,
+                                const PlanParams &params = {});
+  PlanStatus step_plan_search(PlanSearch &search, const PlanBudget &budget);
+  // full plan once found, otherwise the best partial plan so far (forward search only, regression has no executable prefix)
+  float get_plan_search_result(const PlanSearch &search, std::vector<PlanStep> &plan);
   void print_plan(const Planner &planner, const WorldState &init, const std::vector<PlanStep> &plan);
 };
 
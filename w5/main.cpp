@@ -2,10 +2,14 @@
 #include "raylib.h"
 #include <flecs.h>
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
 #include "ecsTypes.h"
 #include "roguelike.h"
 #include "dungeonGen.h"
 #include "goapPlanner.h"
+#include "goapHtn.h"
+#include "decisionPhase.h"
 
 enum EnemyDist
 {
@@ -109,7 +113,7 @@ static void debug_enemy_planner()
   }
 }
 
-static void debug_looter_planner()
+static goap::Planner create_looter_planner()
 {
   goap::Planner pl = goap::create_planner();
 
@@ -197,8 +201,12 @@ static void debug_looter_planner()
       {{"health_state", Healthy}, {"num_loot", 5}},
       {{"escaped", 1}},
       {});
+  return pl;
+}
 
-  goap::WorldState ws = goap::produce_planner_worldstate(pl,
+static goap::WorldState create_looter_worldstate(const goap::Planner &pl)
+{
+  return goap::produce_planner_worldstate(pl,
       {{"enemy_vis", 0},
        {"loot_vis", 1},
        {"num_loot", 0},
@@ -208,18 +216,71 @@ static void debug_looter_planner()
        {"health_state", Healthy},
        {"escaped", 0},
        {"blessed", 0}});
+}
+
+static void debug_looter_planner()
+{
+  goap::Planner pl = create_looter_planner();
+  goap::WorldState ws = create_looter_worldstate(pl);
 
   goap::WorldState goal = goap::produce_planner_worldstate(pl,
       {{"num_loot", 5}, {"escaped", 1}, {"health_state", Healthy}});
 
   std::vector<goap::PlanStep> plan;
-  goap::make_plan(pl, ws, goal, plan);
+  goap::PlanStats stats;
+  goap::make_plan(pl, ws, goal, plan, {goap::HEUR_MAX, goap::SEARCH_AUTO, 1.f}, &stats);
   goap::print_plan(pl, ws, plan);
+  printf("cost: %.1f, expanded: %zu, generated: %zu, bound: %.2f, %s search (branching %.2f fwd / %.2f bwd)\n",
+         double(stats.cost), stats.expandedNodes, stats.generatedNodes, double(stats.suboptimalityBound),
+         stats.direction == goap::SEARCH_BACKWARD ? "backward" : "forward",
+         double(stats.forwardBranching), double(stats.backwardBranching));
+  printf("arena: %zu nodes and states, %zu heap allocations, %zu bytes peak\n",
+         stats.arenaObjects, stats.heapAllocations, stats.peakMemory);
+
+  // same plan, but sliced the way the game loop would run it with a per-frame budget
+  goap::PlanSearch search = goap::create_plan_search(pl, ws, goal, {goap::HEUR_MAX, goap::SEARCH_FORWARD, 1.f});
+  int numSlices = 1;
+  while (goap::step_plan_search(search, {32, 0.f}) == goap::PLAN_IN_PROGRESS)
+    numSlices++;
+  printf("sliced search: %d slices of 32 nodes, status %d\n", numSlices, int(search.status));
 
   for (goap::PlanStep step : plan)
     printf("%d, ", step.action);
 }
 
+// same looter, but the deep "loot everything" part is spelled out as tasks,
+// and only the final escape is left to the GOAP search
+static void debug_looter_htn()
+{
+  goap::Planner pl = create_looter_planner();
+  goap::WorldState ws = create_looter_worldstate(pl);
+
+  goap::HtnDomain domain = goap::create_htn_domain(pl);
+  goap::add_primitive_task(domain, "open_room");
+  goap::add_primitive_task(domain, "loot");
+  goap::add_primitive_task(domain, "hide");
+  goap::add_goal_task(domain, "escape_safely", {{"escaped", 1}, {"health_state", Healthy}});
+
+  goap::add_compound_task(domain, "loot_room");
+  goap::add_method_to_task(domain, "loot_room", "loot_unseen", {{"loot_vis", 1}, {"enemy_vis", 0}}, {"loot"});
+  goap::add_method_to_task(domain, "loot_room", "hide_and_loot", {{"loot_vis", 1}, {"enemy_vis", 1}}, {"hide", "loot"});
+
+  goap::add_compound_task(domain, "collect_loot");
+  goap::add_method_to_task(domain, "collect_loot", "enough", {{"num_loot", 5}}, {});
+  goap::add_method_to_task(domain, "collect_loot", "loot_visible", {{"loot_vis", 1}}, {"loot_room", "collect_loot"});
+  goap::add_method_to_task(domain, "collect_loot", "explore", {}, {"open_room", "loot_room", "collect_loot"});
+
+  goap::add_compound_task(domain, "heist");
+  goap::add_method_to_task(domain, "heist", "loot_and_escape", {}, {"collect_loot", "escape_safely"});
+
+  std::vector<goap::PlanStep> plan;
+  goap::HtnStats stats;
+  const float cost = goap::make_htn_plan(domain, ws, "heist", plan, {goap::HEUR_MAX, goap::SEARCH_AUTO, 1.f}, &stats);
+  goap::print_plan(pl, ws, plan);
+  printf("htn cost: %.1f, tasks: %zu, backtracks: %zu, goal searches: %zu (%zu nodes)\n", double(cost),
+         stats.decomposedTasks, stats.backtracks, stats.goalSearches, stats.goalSearchNodes);
+}
+
 
 static void update_camera(Camera2D &cam, flecs::world &ecs)
 {
@@ -233,8 +294,14 @@ static void update_camera(Camera2D &cam, flecs::world &ecs)
   });
 }
 
-int main(int /*argc*/, const char ** /*argv*/)
+// hw5 [--ai-threads N]
+int main(int argc, const char **argv)
 {
+  size_t numAiThreads = 1;
+  for (int i = 1; i + 1 < argc; ++i)
+    if (strcmp(argv[i], "--ai-threads") == 0)
+      numAiThreads = size_t(std::max(atoi(argv[i + 1]), 1));
+
   int width = 1920;
   int height = 1080;
   InitWindow(width, height, "w3 AI MIPT");
@@ -257,8 +324,11 @@ int main(int /*argc*/, const char ** /*argv*/)
     init_dungeon(ecs, tiles, dungWidth, dungHeight);
   }
   init_roguelike(ecs);
+  ecs.set_stage_count(int32_t(numAiThreads));
+  ecs.set(DecisionPhase{numAiThreads, 0.f, nullptr});
   //debug_enemy_planner();
   debug_looter_planner();
+  debug_looter_htn();
 
   Camera2D camera = { {0, 0}, {0, 0}, 0.f, 1.f };
   camera.target = Vector2{ 0.f, 0.f };
@@ -2,6 +2,7 @@
 #include "ecsTypes.h"
 #include "dungeonUtils.h"
 #include "blackboard.h"
+#include <climits>
 
 flecs::entity create_hive(flecs::entity e)
 {
@@ -43,6 +44,7 @@ flecs::entity create_monster(flecs::world &ecs, Color col, const char *texture_s
     .set(Team{1})
     .set(NumActions{1, 0})
     .set(MeleeDamage{20.f})
+    .set(AiRandom{uint32_t(GetRandomValue(1, INT_MAX))})
     .set(Blackboard{});
 }
 
@@ -3,14 +3,104 @@
 #include "raylib.h"
 #include "stateMachine.h"
 #include "aiLibrary.h"
+#include "behProgram.h"
 #include "blackboard.h"
 #include "math.h"
 #include "dungeonUtils.h"
 #include "dijkstraMapGen.h"
-#include "dmapFollower.h"
 #include "dmapBeh.h"
 #include "rlikeObjects.h"
+#include "sensorIndex.h"
+#include "decisionPhase.h"
 
+// trees are compiled once, monsters only get a blackboard and a cursor into the shared program
+static void create_fuzzy_monster_beh(flecs::entity e)
+{
+  static const std::shared_ptr<const BehProgram> fuzzyMonsterBeh = beh::compile(
+    beh::utility_selector({
+      std::make_pair(
+        beh::sequence({
+          beh::find_enemy(4.f, "flee_enemy"),
+          beh::flee("flee_enemy")
+        }),
+        UtilityScorer{{"hp", "enemyDist"}, [](const float *in)
+        {
+          const float hp = in[0];
+          const float enemyDist = in[1];
+          return (100.f - hp) * 5.f - 50.f * enemyDist;
+        }}
+      ),
+      std::make_pair(
+        beh::sequence({
+          beh::find_enemy(3.f, "attack_enemy"),
+          beh::move_to_entity("attack_enemy")
+        }),
+        UtilityScorer{{"enemyDist"}, [](const float *in)
+        {
+          const float enemyDist = in[0];
+          return 100.f - 10.f * enemyDist;
+        }}
+      ),
+      std::make_pair(
+        beh::patrol(2.f, "patrol_pos"),
+        UtilityScorer{{}, [](const float *)
+        {
+          return 50.f;
+        }}
+      ),
+      std::make_pair(
+        beh::patch_up(100.f),
+        UtilityScorer{{"hp"}, [](const float *in)
+        {
+          const float hp = in[0];
+          return 140.f - hp;
+        }}
+      )
+    }));
+  e.add<WorldInfoGatherer>();
+  set_compiled_beh(e, fuzzyMonsterBeh);
+}
+
+static void create_minotaur_beh(flecs::entity e)
+{
+  static const std::shared_ptr<const BehProgram> minotaurBeh = beh::compile(
+    beh::selector({
+      beh::sequence({
+        beh::is_low_hp(50.f),
+        beh::find_enemy(4.f, "flee_enemy"),
+        beh::flee("flee_enemy")
+      }),
+      beh::sequence({
+        beh::find_enemy(3.f, "attack_enemy"),
+        beh::move_to_entity("attack_enemy")
+      }),
+      beh::patrol(2.f, "patrol_pos")
+    }));
+  set_compiled_beh(e, minotaurBeh, BEH_TICK_EVENT_DRIVEN);
+}
+
+// machine definition is shared, monsters only keep the current state
+static void create_patrol_attack_flee_sm(flecs::entity e)
+{
+  static const std::shared_ptr<const FsmDefinition> patrolAttackFleeSm = []()
+  {
+    fsm::Description desc;
+    const uint32_t patrol = desc.addState(FSO_PATROL, 3.f);
+    const uint32_t moveToEnemy = desc.addState(FSO_MOVE_TO_ENEMY);
+    const uint32_t fleeFromEnemy = desc.addState(FSO_FLEE_FROM_ENEMY);
+
+    desc.addTransition({fsm::enemy_available(3.f)}, patrol, moveToEnemy);
+    desc.addTransition({fsm::negate(fsm::enemy_available(5.f))}, moveToEnemy, patrol);
+
+    desc.addTransition({fsm::hitpoints_less_than(60.f), fsm::enemy_available(5.f)}, moveToEnemy, fleeFromEnemy);
+    desc.addTransition({fsm::hitpoints_less_than(60.f), fsm::enemy_available(3.f)}, patrol, fleeFromEnemy);
+
+    desc.addTransition({fsm::negate(fsm::enemy_available(7.f))}, fleeFromEnemy, patrol);
+    return fsm::build(desc);
+  }();
+  e.add<WorldInfoGatherer>();
+  set_state_machine(e, patrolAttackFleeSm);
+}
 
 static void register_roguelike_systems(flecs::world &ecs)
 {
@@ -152,12 +242,18 @@ void init_roguelike(flecs::world &ecs)
   create_hive_monster(create_monster(ecs, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
   create_hive_monster(create_monster(ecs, Color{0x11, 0x11, 0x11, 0xff}, "minotaur_tex"));
   create_hive(create_player_fleer(create_monster(ecs, Color{0, 255, 0, 255}, "minotaur_tex")));
+  create_minotaur_beh(create_monster(ecs, Color{0xee, 0xee, 0x00, 0xff}, "minotaur_tex"));
+  create_fuzzy_monster_beh(create_monster(ecs, Color{0x00, 0xee, 0xee, 0xff}, "minotaur_tex"));
+  create_patrol_attack_flee_sm(create_monster(ecs, Color{0xee, 0x44, 0x00, 0xff}, "minotaur_tex"));
 
   create_player(ecs, "swordsman_tex");
 
   ecs.entity("world")
     .set(TurnCounter{})
     .set(ActionLog{});
+  ecs.set(SensorIndex{});
+  ecs.set(DecisionPhase{});
+  ecs.set(AiLod{});
 }
 
 void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h)
@@ -321,13 +417,6 @@ static void process_actions(flecs::world &ecs)
   });
 }
 
-template<typename T>
-static void push_info_to_bb(Blackboard &bb, const char *name, const T &val)
-{
-  size_t idx = bb.regName<T>(name);
-  bb.set(idx, val);
-}
-
 // sensors
 static void gather_world_info(flecs::world &ecs)
 {
@@ -335,54 +424,38 @@ static void gather_world_info(flecs::world &ecs)
                                           const Position, const Hitpoints,
                                           const WorldInfoGatherer,
                                           const Team>();
-  auto alliesQuery = ecs.query<const Position, const Team>();
+  const SensorIndex *index = ecs.get<SensorIndex>();
+  if (!index)
+    return; // TODO: Assert
   gatherWorldInfo.each([&](Blackboard &bb, const Position &pos, const Hitpoints &hp,
                            WorldInfoGatherer, const Team &team)
   {
-    // first gather all needed names (without cache)
-    push_info_to_bb(bb, "hp", hp.hitpoints);
-    float numAllies = 0; // note float
+    // sensor keys are compile time slots of the shared schema, no name lookups per agent
+    bb.set(bb_hp, hp.hitpoints);
+    constexpr float limitDist = 5.f;
+    const float numAllies = float(sensors::count_allies_within(*index, pos, team.team, limitDist)); // note float
+    SensorAgent closestEnemy;
     float closestEnemyDist = 100.f;
-    alliesQuery.each([&](const Position &apos, const Team &ateam)
-    {
-      constexpr float limitDist = 5.f;
-      if (team.team == ateam.team && dist_sq(pos, apos) < sqr(limitDist))
-        numAllies += 1.f;
-      if (team.team != ateam.team)
-      {
-        const float enemyDist = dist(pos, apos);
-        if (enemyDist < closestEnemyDist)
-          closestEnemyDist = enemyDist;
-      }
-    });
-    push_info_to_bb(bb, "alliesNum", numAllies);
-    push_info_to_bb(bb, "enemyDist", closestEnemyDist);
+    sensors::find_nearest_enemy(*index, pos, team.team, closestEnemyDist, closestEnemy, closestEnemyDist);
+    bb.set(bb_allies_num, numAllies);
+    bb.set(bb_enemy_dist, closestEnemyDist);
   });
 }
 
 void process_turn(flecs::world &ecs)
 {
-  auto stateMachineAct = ecs.query<StateMachine>();
-  auto behTreeUpdate = ecs.query<BehaviourTree, Blackboard>();
+  auto blackboards = ecs.query<Blackboard>();
   auto turnIncrementer = ecs.query<TurnCounter>();
   if (is_player_acted(ecs))
   {
     if (upd_player_actions_count(ecs))
     {
       // Plan action for NPCs
+      sensors::build_sensor_index(ecs);
       gather_world_info(ecs);
-      ecs.defer([&]
-      {
-        stateMachineAct.each([&](flecs::entity e, StateMachine &sm)
-        {
-          sm.act(0.f, ecs, e);
-        });
-        behTreeUpdate.each([&](flecs::entity e, BehaviourTree &bt, Blackboard &bb)
-        {
-          bt.update(ecs, e, bb);
-        });
-        process_dmap_followers(ecs);
-      });
+      run_decision_phase(ecs);
+      // next turn subscribers find this turn's sensor writes in the dirty masks
+      blackboards.each([](Blackboard &bb) { bb.clearDirty(); });
       turnIncrementer.each([](TurnCounter &tc) { tc.count++; });
     }
     process_actions(ecs);
@@ -417,6 +490,12 @@ void print_stats(flecs::world &ecs)
     DrawText(TextFormat("hp: %d", int(hp.hitpoints)), 20, 20, 20, WHITE);
     DrawText(TextFormat("power: %d", int(dmg.damage)), 20, 40, 20, WHITE);
   });
+  if (const DecisionPhase *phase = ecs.get<DecisionPhase>())
+    DrawText(TextFormat("ai: %.2f ms, %d threads", double(phase->lastMilliseconds), int(phase->numThreads)), 20, 60, 20, WHITE);
+  if (const AiLod *lod = ecs.get<AiLod>())
+    for (size_t i = 0; i < lod->tierAgents.size() && i < lod->tierTicked.size(); ++i)
+      DrawText(TextFormat("lod %d: %d/%d ticked", int(i), int(lod->tierTicked[i]), int(lod->tierAgents[i])),
+               20, 80 + int(i) * 20, 20, WHITE);
 
   auto actionLogQuery = ecs.query<const ActionLog>();
   actionLogQuery.each([&](const ActionLog &l)
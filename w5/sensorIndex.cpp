@@ -0,0 +1,128 @@
+#include "sensorIndex.h"
+#include <climits>
+
+// floor division, positions asked about may lie outside of the grid
+static int to_cell(int v, int min_v, int cell_size)
+{
+  const int d = v - min_v;
+  return d >= 0 ? d / cell_size : -((-d + cell_size - 1) / cell_size);
+}
+
+static SensorTeam &get_sensor_team(SensorIndex &index, int team)
+{
+  for (SensorTeam &st : index.teams)
+    if (st.team == team)
+      return st;
+  index.teams.push_back(SensorTeam{team, {}, {}});
+  return index.teams.back();
+}
+
+void sensors::build_sensor_index(flecs::world &ecs)
+{
+  SensorIndex *index = ecs.get_mut<SensorIndex>();
+  if (!index)
+    return; // TODO: Assert
+  auto charactersQuery = ecs.query<const Position, const Team>();
+
+  index->snapshot.clear();
+  index->snapshotTeams.clear();
+  int maxX = INT_MIN;
+  int maxY = INT_MIN;
+  index->minX = INT_MAX;
+  index->minY = INT_MAX;
+  charactersQuery.each([&](flecs::entity e, const Position &pos, const Team &team)
+  {
+    index->snapshot.push_back(SensorAgent{e, pos});
+    index->snapshotTeams.push_back(team.team);
+    index->minX = std::min(index->minX, pos.x);
+    index->minY = std::min(index->minY, pos.y);
+    maxX = std::max(maxX, pos.x);
+    maxY = std::max(maxY, pos.y);
+  });
+  for (SensorTeam &st : index->teams)
+    st.agents.clear();
+  if (index->snapshot.empty())
+  {
+    index->minX = index->minY = 0;
+    index->width = index->height = 0;
+    for (SensorTeam &st : index->teams)
+      st.cellStart.assign(1, 0u);
+    return;
+  }
+  index->width = (maxX - index->minX) / index->cellSize + 1;
+  index->height = (maxY - index->minY) / index->cellSize + 1;
+  const size_t numCells = size_t(index->width) * size_t(index->height);
+
+  index->snapshotCells.resize(index->snapshot.size());
+  for (size_t i = 0; i < index->snapshot.size(); ++i)
+  {
+    const Position &pos = index->snapshot[i].pos;
+    index->snapshotCells[i] = uint32_t((pos.y - index->minY) / index->cellSize * index->width +
+                                       (pos.x - index->minX) / index->cellSize);
+    get_sensor_team(*index, index->snapshotTeams[i]);
+  }
+
+  // counting sort by cell, snapshot order is kept within a cell
+  for (SensorTeam &st : index->teams)
+  {
+    st.cellStart.assign(numCells + 1, 0u);
+    for (size_t i = 0; i < index->snapshot.size(); ++i)
+      if (index->snapshotTeams[i] == st.team)
+        st.cellStart[index->snapshotCells[i] + 1]++;
+    for (size_t c = 0; c < numCells; ++c)
+      st.cellStart[c + 1] += st.cellStart[c];
+    st.agents.resize(st.cellStart[numCells]);
+    for (size_t i = 0; i < index->snapshot.size(); ++i)
+      if (index->snapshotTeams[i] == st.team)
+        st.agents[st.cellStart[index->snapshotCells[i]]++] = index->snapshot[i];
+    // placement advanced the starts by one cell
+    for (size_t c = numCells; c > 0; --c)
+      st.cellStart[c] = st.cellStart[c - 1];
+    st.cellStart[0] = 0;
+  }
+}
+
+bool sensors::find_nearest_enemy(const SensorIndex &index, const Position &pos, int team, float max_dist,
+                                 SensorAgent &enemy, float &enemy_dist)
+{
+  const int hx = to_cell(pos.x, index.minX, index.cellSize);
+  const int hy = to_cell(pos.y, index.minY, index.cellSize);
+  const int maxRing = std::max(std::max(hx, index.width - 1 - hx), std::max(hy, index.height - 1 - hy));
+  bool found = false;
+  float closestDist = max_dist;
+  auto visit = [&](const SensorAgent &agent)
+  {
+    const float curDist = dist(agent.pos, pos);
+    if (curDist < closestDist || (!found && curDist <= max_dist))
+    {
+      closestDist = curDist;
+      enemy = agent;
+      found = true;
+    }
+  };
+  // rings of cells around the home one, agents of ring r are at least (r - 1) cells away
+  for (int r = 0; r <= maxRing && float((r - 1) * index.cellSize) <= closestDist; ++r)
+    for (const SensorTeam &st : index.teams)
+    {
+      if (st.team == team || st.agents.empty())
+        continue;
+      if (r == 0)
+      {
+        for_each_in_cells(st, index, hx, hy, hx, hy, visit);
+        continue;
+      }
+      for_each_in_cells(st, index, hx - r, hy - r, hx + r, hy - r, visit);
+      for_each_in_cells(st, index, hx - r, hy + r, hx + r, hy + r, visit);
+      for_each_in_cells(st, index, hx - r, hy - r + 1, hx - r, hy + r - 1, visit);
+      for_each_in_cells(st, index, hx + r, hy - r + 1, hx + r, hy + r - 1, visit);
+    }
+  enemy_dist = closestDist;
+  return found;
+}
+
+size_t sensors::count_allies_within(const SensorIndex &index, const Position &pos, int team, float radius)
+{
+  size_t count = 0;
+  for_each_ally_within(index, pos, team, radius, [&](const SensorAgent &) { ++count; });
+  return count;
+}
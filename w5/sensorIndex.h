@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <flecs.h>
+#include "ecsTypes.h"
+#include "math.h"
+
+struct SensorAgent
+{
+  flecs::entity entity;
+  Position pos;
+};
+
+// agents of one team sorted by grid cell, cell c holds agents[cellStart[c], cellStart[c + 1])
+struct SensorTeam
+{
+  int team = 0;
+  std::vector<uint32_t> cellStart;
+  std::vector<SensorAgent> agents;
+};
+
+// Snapshot of Position and Team of all characters taken at the start of the turn decision phase,
+// partitioned by team and bucketed into a uniform grid. It's a world singleton, sensors read it
+// instead of scanning all characters, so they cost the nearby agents only.
+struct SensorIndex
+{
+  int cellSize = 4;
+  int minX = 0;
+  int minY = 0;
+  int width = 0;  // in cells
+  int height = 0; // in cells
+  std::vector<SensorTeam> teams;
+  // scratch of the build, kept to reuse allocations between turns
+  std::vector<SensorAgent> snapshot;
+  std::vector<int> snapshotTeams;
+  std::vector<uint32_t> snapshotCells;
+};
+
+namespace sensors
+{
+  void build_sensor_index(flecs::world &ecs);
+
+  // closest agent of another team within max_dist, returns false if there is none
+  bool find_nearest_enemy(const SensorIndex &index, const Position &pos, int team, float max_dist,
+                          SensorAgent &enemy, float &enemy_dist);
+  // agents of the team closer than radius, the agent itself included
+  size_t count_allies_within(const SensorIndex &index, const Position &pos, int team, float radius);
+
+  template<typename Callable>
+  void for_each_ally_within(const SensorIndex &index, const Position &pos, int team, float radius, Callable c);
+};
+
+namespace sensors
+{
+  template<typename Callable>
+  void for_each_in_cells(const SensorTeam &st, const SensorIndex &index, int x0, int y0, int x1, int y1, Callable c)
+  {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, index.width - 1);
+    y1 = std::min(y1, index.height - 1);
+    for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x)
+      {
+        const size_t cell = size_t(y * index.width + x);
+        for (uint32_t i = st.cellStart[cell]; i < st.cellStart[cell + 1]; ++i)
+          c(st.agents[i]);
+      }
+  }
+
+  template<typename Callable>
+  void for_each_ally_within(const SensorIndex &index, const Position &pos, int team, float radius, Callable c)
+  {
+    const float radiusSq = radius * radius;
+    const int reach = int(radius) + 1;
+    for (const SensorTeam &st : index.teams)
+    {
+      if (st.team != team || st.agents.empty())
+        continue;
+      for_each_in_cells(st, index,
+                        (pos.x - reach - index.minX) / index.cellSize, (pos.y - reach - index.minY) / index.cellSize,
+                        (pos.x + reach - index.minX) / index.cellSize, (pos.y + reach - index.minY) / index.cellSize,
+                        [&](const SensorAgent &agent)
+      {
+        if (dist_sq(agent.pos, pos) < radiusSq)
+          c(agent);
+      });
+    }
+  }
+};
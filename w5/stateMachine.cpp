@@ -1,44 +1,213 @@
 #include "stateMachine.h"
+#include <algorithm>
+#include "ecsTypes.h"
+#include "aiUtils.h"
+#include "math.h"
 
-StateMachine::~StateMachine()
+FsmCondition fsm::enemy_available(float dist) { return FsmCondition{FCO_ENEMY_AVAILABLE, false, dist}; }
+FsmCondition fsm::enemy_reachable() { return FsmCondition{FCO_ENEMY_REACHABLE, false, 0.f}; }
+FsmCondition fsm::hitpoints_less_than(float thres) { return FsmCondition{FCO_HITPOINTS_LESS_THAN, false, thres}; }
+
+FsmCondition fsm::negate(FsmCondition cond)
+{
+  cond.negate = !cond.negate;
+  return cond;
+}
+
+uint32_t fsm::Description::addState(FsmStateOp op, float param)
+{
+  states.emplace_back(op, param);
+  return uint32_t(states.size() - 1);
+}
+
+void fsm::Description::addTransition(std::vector<FsmCondition> conditions, uint32_t from, uint32_t to)
 {
-  for (State* state : states)
-    delete state;
-  states.clear();
-  for (auto &transList : transitions)
-    for (auto &transition : transList)
-      delete transition.first;
-  transitions.clear();
+  if (from >= states.size() || to >= states.size())
+    return; // TODO: Assert
+  transitions.push_back(Transition{from, to, std::move(conditions)});
 }
 
-void StateMachine::act(float dt, flecs::world &ecs, flecs::entity entity)
+// states
+
+static void act_attack_enemy(flecs::world &, flecs::entity, float) {}
+
+static void act_move_to_enemy(flecs::world &ecs, flecs::entity entity, float)
 {
-  if (curStateIdx < states.size())
+  on_closest_enemy_pos(ecs, entity, [&](Action &a, const Position &pos, const Position &enemy_pos)
   {
-    for (const std::pair<StateTransition*, int> &transition : transitions[curStateIdx])
-      if (transition.first->isAvailable(ecs, entity))
+    a.action = move_towards(pos, enemy_pos);
+  });
+}
+
+static void act_flee_from_enemy(flecs::world &ecs, flecs::entity entity, float)
+{
+  on_closest_enemy_pos(ecs, entity, [&](Action &a, const Position &pos, const Position &enemy_pos)
+  {
+    a.action = inverse_move(move_towards(pos, enemy_pos));
+  });
+}
+
+static void act_patrol(flecs::world &, flecs::entity entity, float patrol_dist)
+{
+  entity.insert([&](const Position &pos, const PatrolPos &ppos, Action &a, AiRandom &rnd)
+  {
+    if (dist(pos, ppos) > patrol_dist)
+      a.action = move_towards(pos, ppos); // do a recovery walk
+    else
+    {
+      // do a random walk
+      a.action = ai_random_value(rnd, EA_MOVE_START, EA_MOVE_END - 1);
+    }
+  });
+}
+
+static void act_nop(flecs::world &, flecs::entity, float) {}
+
+static void (*const state_acts[FSO_NUM])(flecs::world &, flecs::entity, float) =
+{
+  act_attack_enemy,    // FSO_ATTACK_ENEMY
+  act_move_to_enemy,   // FSO_MOVE_TO_ENEMY
+  act_flee_from_enemy, // FSO_FLEE_FROM_ENEMY
+  act_patrol,          // FSO_PATROL
+  act_nop              // FSO_NOP
+};
+
+// conditions
+
+static bool is_enemy_available(flecs::world &ecs, flecs::entity entity, float trigger_dist)
+{
+  const SensorIndex *index = ecs.get<SensorIndex>();
+  if (!index)
+    return false; // TODO: Assert
+  bool enemiesFound = false;
+  entity.get([&](const Position &pos, const Team &t)
+  {
+    SensorAgent enemy;
+    float enemyDist = 0.f;
+    enemiesFound = sensors::find_nearest_enemy(*index, pos, t.team, trigger_dist, enemy, enemyDist);
+  });
+  return enemiesFound;
+}
+
+static bool is_enemy_reachable(flecs::world &, flecs::entity, float)
+{
+  return false;
+}
+
+static bool is_hitpoints_less_than(flecs::world &, flecs::entity entity, float threshold)
+{
+  bool hitpointsThresholdReached = false;
+  entity.get([&](const Hitpoints &hp)
+  {
+    hitpointsThresholdReached |= hp.hitpoints < threshold;
+  });
+  return hitpointsThresholdReached;
+}
+
+static bool (*const condition_checks[FCO_NUM])(flecs::world &, flecs::entity, float) =
+{
+  is_enemy_available,    // FCO_ENEMY_AVAILABLE
+  is_enemy_reachable,    // FCO_ENEMY_REACHABLE
+  is_hitpoints_less_than // FCO_HITPOINTS_LESS_THAN
+};
+
+// Sensor written for WorldInfoGatherer entities right before they act which gives the same answer,
+// enemyDist is the closest enemy distance of the same query. Returns false when a condition depends on anything else.
+static bool get_condition_sensor_input(FsmConditionOp op, BbSlotMask &inputs)
+{
+  switch (op)
+  {
+    case FCO_ENEMY_AVAILABLE:
+      inputs.add(bb_enemy_dist.slot);
+      return true;
+    case FCO_ENEMY_REACHABLE:
+      return true;
+    case FCO_HITPOINTS_LESS_THAN:
+      inputs.add(bb_hp.slot);
+      return true;
+    case FCO_NUM:
+      break;
+  }
+  return false;
+}
+
+std::shared_ptr<const FsmDefinition> fsm::build(const Description &desc)
+{
+  std::shared_ptr<FsmDefinition> def = std::make_shared<FsmDefinition>();
+  for (uint32_t from = 0; from < desc.states.size(); ++from)
+  {
+    FsmState state;
+    state.op = desc.states[from].first;
+    state.param = desc.states[from].second;
+    state.transitionsBegin = uint32_t(def->transitions.size());
+    for (const Description::Transition &trans : desc.transitions)
+    {
+      if (trans.from != from)
+        continue;
+      FsmTransition transition;
+      transition.conditionsBegin = uint32_t(def->conditions.size());
+      for (const FsmCondition &cond : trans.conditions)
       {
-        states[curStateIdx]->exit();
-        curStateIdx = size_t(transition.second);
-        states[curStateIdx]->enter();
-        break;
+        def->conditions.push_back(cond);
+        if (!get_condition_sensor_input(cond.op, state.transitionInputs))
+          state.transitionsTracked = false;
       }
-    states[curStateIdx]->act(dt, ecs, entity);
+      transition.conditionsEnd = uint32_t(def->conditions.size());
+      transition.to = trans.to;
+      def->transitions.push_back(transition);
+    }
+    state.transitionsEnd = uint32_t(def->transitions.size());
+    def->states.push_back(state);
   }
-  else
-    curStateIdx = 0;
+  return def;
 }
 
-int StateMachine::addState(State *st)
+flecs::entity set_state_machine(flecs::entity e, std::shared_ptr<const FsmDefinition> definition)
 {
-  size_t idx = states.size();
-  states.push_back(st);
-  transitions.push_back(std::vector<std::pair<StateTransition*, int>>());
-  return int(idx);
+  if (std::any_of(definition->states.begin(), definition->states.end(),
+                  [](const FsmState &state) { return state.op == FSO_PATROL; }))
+    if (const Position *pos = e.get<Position>())
+      e.set(PatrolPos{pos->x, pos->y});
+  return e.set(StateMachine{std::move(definition), 0, {}});
 }
 
-void StateMachine::addTransition(StateTransition *trans, int from, int to)
+static bool is_transition_available(flecs::world &ecs, flecs::entity entity, const FsmDefinition &def,
+                                    const FsmTransition &trans)
 {
-  transitions[size_t(from)].push_back(std::make_pair(trans, to));
+  for (uint32_t i = trans.conditionsBegin; i < trans.conditionsEnd; ++i)
+  {
+    const FsmCondition &cond = def.conditions[i];
+    if (condition_checks[cond.op](ecs, entity, cond.param) == cond.negate)
+      return false;
+  }
+  return true;
 }
 
+void update_state_machine(flecs::world &ecs, flecs::entity entity, StateMachine &sm)
+{
+  if (!sm.definition || sm.definition->states.empty())
+    return;
+  const FsmDefinition &def = *sm.definition;
+  if (sm.curState >= def.states.size())
+    sm.curState = 0;
+  const FsmState &state = def.states[sm.curState];
+  const Blackboard *bb = state.transitionsTracked && entity.has<WorldInfoGatherer>() ?
+                         entity.get<Blackboard>() : nullptr;
+  sm.transitionsSub.inputs = state.transitionInputs;
+  if (!bb || bb->needsUpdate(sm.transitionsSub))
+  {
+    const uint32_t prevState = sm.curState;
+    for (uint32_t i = state.transitionsBegin; i < state.transitionsEnd; ++i)
+      if (is_transition_available(ecs, entity, def, def.transitions[i]))
+      {
+        sm.curState = def.transitions[i].to;
+        break;
+      }
+    if (bb && sm.curState == prevState)
+      bb->markUpdated(sm.transitionsSub);
+    else
+      sm.transitionsSub.evaluated = false;
+  }
+  const FsmState &curState = def.states[sm.curState];
+  state_acts[curState.op](ecs, entity, curState.param);
+}
@@ -1,42 +1,99 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <cstdint>
 #include <flecs.h>
+#include "blackboard.h"
 
-class State
+enum FsmStateOp : uint8_t
 {
-public:
-  virtual ~State() {}
-  virtual void enter() const = 0;
-  virtual void exit() const = 0;
-  virtual void act(float dt, flecs::world &ecs, flecs::entity entity) const = 0;
+  FSO_ATTACK_ENEMY = 0,
+  FSO_MOVE_TO_ENEMY,
+  FSO_FLEE_FROM_ENEMY,
+  FSO_PATROL,
+  FSO_NOP,
+  FSO_NUM
 };
 
-class StateTransition
+enum FsmConditionOp : uint8_t
 {
-public:
-  virtual ~StateTransition() {}
-  virtual bool isAvailable(flecs::world &ecs, flecs::entity entity) const = 0;
+  FCO_ENEMY_AVAILABLE = 0,
+  FCO_ENEMY_REACHABLE,
+  FCO_HITPOINTS_LESS_THAN,
+  FCO_NUM
 };
 
-class StateMachine
+struct FsmCondition
 {
-  size_t curStateIdx = 0;
-  std::vector<State*> states;
-  std::vector<std::vector<std::pair<StateTransition*, int>>> transitions;
-public:
-  StateMachine() = default;
-  StateMachine(const StateMachine &sm) = default;
-  StateMachine(StateMachine &&sm) = default;
+  FsmConditionOp op = FCO_ENEMY_REACHABLE;
+  bool negate = false;
+  float param = 0.f;
+};
 
-  ~StateMachine();
+// fires when all of its conditions hold, conditions are a range of FsmDefinition::conditions
+struct FsmTransition
+{
+  uint32_t conditionsBegin = 0;
+  uint32_t conditionsEnd = 0;
+  uint32_t to = 0;
+};
 
-  StateMachine &operator=(const StateMachine &sm) = default;
-  StateMachine &operator=(StateMachine &&sm) = default;
+struct FsmState
+{
+  FsmStateOp op = FSO_NOP;
+  float param = 0.f;
+  // outgoing transitions in priority order, range of FsmDefinition::transitions
+  uint32_t transitionsBegin = 0;
+  uint32_t transitionsEnd = 0;
+  // sensor slots of all outgoing conditions, tracked if the conditions depend on nothing else
+  BbSlotMask transitionInputs;
+  bool transitionsTracked = true;
+};
+
+// Immutable machine shared by every entity running it, states and conditions are dispatched by op.
+struct FsmDefinition
+{
+  std::vector<FsmState> states;
+  std::vector<FsmTransition> transitions;
+  std::vector<FsmCondition> conditions;
+};
+
+// Per entity part of a machine, everything else lives in the shared definition.
+struct StateMachine
+{
+  std::shared_ptr<const FsmDefinition> definition;
+  uint32_t curState = 0;
+  // transitions of the current state are skipped while their sensor inputs are unchanged and none fired
+  BbSubscription transitionsSub;
+};
+
+namespace fsm
+{
+  FsmCondition enemy_available(float dist);
+  FsmCondition enemy_reachable();
+  FsmCondition hitpoints_less_than(float thres);
+  FsmCondition negate(FsmCondition cond);
 
+  // machine description, it's only used to build a definition
+  struct Description
+  {
+    struct Transition
+    {
+      uint32_t from;
+      uint32_t to;
+      std::vector<FsmCondition> conditions;
+    };
+    std::vector<std::pair<FsmStateOp, float>> states;
+    std::vector<Transition> transitions;
 
-  void act(float dt, flecs::world &ecs, flecs::entity entity);
+    uint32_t addState(FsmStateOp op, float param = 0.f);
+    // transitions of a state are checked in the order they were added
+    void addTransition(std::vector<FsmCondition> conditions, uint32_t from, uint32_t to);
+  };
 
-  int addState(State *st);
-  void addTransition(StateTransition *trans, int from, int to);
+  std::shared_ptr<const FsmDefinition> build(const Description &desc);
 };
 
+// Attaches the machine in its first state, patrolling machines remember the current position as the patrol one.
+flecs::entity set_state_machine(flecs::entity e, std::shared_ptr<const FsmDefinition> definition);
+void update_state_machine(flecs::world &ecs, flecs::entity entity, StateMachine &sm);
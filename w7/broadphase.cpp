@@ -0,0 +1,81 @@
+#include "broadphase.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+void clear_broadphase_bodies(Broadphase &bp)
+{
+  bp.entities.clear();
+  bp.centers.clear();
+  bp.teams.clear();
+}
+
+void push_broadphase_body(Broadphase &bp, flecs::entity e, const Position &pos, float tile_size, int team)
+{
+  bp.entities.push_back(e);
+  bp.centers.push_back(Position{pos.x + tile_size * 0.5f, pos.y + tile_size * 0.5f});
+  bp.teams.push_back(team);
+}
+
+static bool is_wall(const DungeonData &dd, int x, int y)
+{
+  return x >= 0 && y >= 0 && size_t(x) < dd.width && size_t(y) < dd.height &&
+         dd.tiles[size_t(y) * dd.width + size_t(x)] == dungeon::wall;
+}
+
+// walls are tiles, only the few tiles under the body bounds are tested
+static void find_wall_overlaps(Broadphase &bp, const DungeonData &dd, float tile_size)
+{
+  const float radiusSq = bp.radius * bp.radius;
+  for (size_t i = 0; i < bp.centers.size(); ++i)
+  {
+    const Position &c = bp.centers[i];
+    const int minX = int(floorf((c.x - bp.radius) / tile_size));
+    const int maxX = int(floorf((c.x + bp.radius) / tile_size));
+    const int minY = int(floorf((c.y - bp.radius) / tile_size));
+    const int maxY = int(floorf((c.y + bp.radius) / tile_size));
+    for (int y = minY; y <= maxY; ++y)
+      for (int x = minX; x <= maxX; ++x)
+      {
+        if (!is_wall(dd, x, y))
+          continue;
+        // closest point of the tile to the body center
+        const Position closest{std::clamp(c.x, float(x) * tile_size, float(x + 1) * tile_size),
+                               std::clamp(c.y, float(y) * tile_size, float(y + 1) * tile_size)};
+        if (length_sq(closest - c) >= radiusSq)
+          continue;
+        bp.wallOverlaps.push_back(WallOverlap{uint32_t(i), uint32_t(size_t(y) * dd.width + size_t(x))});
+      }
+  }
+}
+
+void build_broadphase_pairs(Broadphase &bp, const DungeonData *dd, float tile_size)
+{
+  using clock = std::chrono::steady_clock;
+  const clock::time_point startTime = clock::now();
+  bp.playerMonsterPairs.clear();
+  bp.monsterPairs.clear();
+  bp.wallOverlaps.clear();
+
+  const float diameter = bp.radius * 2.f;
+  build_spatial_hash(bp.hash, diameter, bp.centers);
+  const float diameterSq = diameter * diameter;
+  for (size_t i = 0; i < bp.centers.size(); ++i)
+    for_each_neighbour(bp.hash, bp.centers[i], [&](uint32_t j, float distSq)
+    {
+      // every pair once, touching bodies don't overlap
+      if (j <= i || distSq >= diameterSq)
+        return;
+      if (bp.teams[i] == bp.teams[j])
+        bp.monsterPairs.push_back(OverlapPair{uint32_t(i), j});
+      else if (bp.teams[i] == 0)
+        bp.playerMonsterPairs.push_back(OverlapPair{uint32_t(i), j});
+      else
+        bp.playerMonsterPairs.push_back(OverlapPair{j, uint32_t(i)});
+    });
+  if (dd)
+    find_wall_overlaps(bp, *dd, tile_size);
+
+  bp.buildMilliseconds = std::chrono::duration<double, std::milli>(clock::now() - startTime).count();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <flecs.h>
+#include <vector>
+#include <cstdint>
+#include "ecsTypes.h"
+#include "spatialHash.h"
+
+struct OverlapPair
+{
+  uint32_t a; // indices into Broadphase bodies
+  uint32_t b;
+};
+
+struct WallOverlap
+{
+  uint32_t body;
+  uint32_t tile; // y * width + x of the dungeon tile
+};
+
+// Per-frame overlaps of round bodies of one radius, bodies sit in the middle of their tile sized sprite.
+// Bodies go into a spatial hash with cells of the body diameter, so every overlap is found by one 3x3 query.
+struct Broadphase
+{
+  float radius = 32.f;
+  std::vector<flecs::entity> entities;
+  std::vector<Position> centers;
+  std::vector<int> teams;
+  SpatialHash hash;
+  std::vector<OverlapPair> playerMonsterPairs; // bodies of different teams, player first
+  std::vector<OverlapPair> monsterPairs;       // bodies of the same team
+  std::vector<WallOverlap> wallOverlaps;
+  // stats of the last build
+  double buildMilliseconds = 0.0;
+};
+
+void clear_broadphase_bodies(Broadphase &bp);
+// pos is the sprite corner like Position of the drawn entities
+void push_broadphase_body(Broadphase &bp, flecs::entity e, const Position &pos, float tile_size, int team);
+// rebuilds the hash and all pairs, dd can be null when there are no walls
+void build_broadphase_pairs(Broadphase &bp, const DungeonData *dd, float tile_size);
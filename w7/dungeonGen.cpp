@@ -2,12 +2,10 @@
 #include "dungeonUtils.h"
 #include <cstring> // memset
 #include <cstdio> // printf
-#include <random>
-#include <chrono> // std::chrono
-#include <functional> // std::bind
+#include <vector>
+#include <raylib.h>
 #include "ecsTypes.h"
 #include "math.h"
-#include <limits>
 
 void gen_drunk_dungeon(char *tiles, size_t w, size_t h)
 {
@@ -16,20 +14,10 @@ void gen_drunk_dungeon(char *tiles, size_t w, size_t h)
 
   memset(tiles, dungeon::wall, w * h);
 
-  // generator
-  unsigned seed = unsigned(std::chrono::system_clock::now().time_since_epoch().count() % std::numeric_limits<int>::max());
-  std::default_random_engine seedGenerator(seed);
-  std::default_random_engine widthGenerator(seedGenerator());
-  std::default_random_engine heightGenerator(seedGenerator());
-  std::default_random_engine dirGenerator(seedGenerator());
-
-  // distributions
-  std::uniform_int_distribution<size_t> widthDist(1, w-2);
-  std::uniform_int_distribution<size_t> heightDist(1, h-2);
-  std::uniform_int_distribution<size_t> dirDist(0, 3);
-  auto rndWd = std::bind(widthDist, widthGenerator);
-  auto rndHt = std::bind(heightDist, heightGenerator);
-  auto rndDir = std::bind(dirDist, dirGenerator);
+  // raylib generator, SetRandomSeed makes the dungeon reproducible
+  auto rndWd = [&]() { return size_t(GetRandomValue(1, int(w) - 2)); };
+  auto rndHt = [&]() { return size_t(GetRandomValue(1, int(h) - 2)); };
+  auto rndDir = []() { return size_t(GetRandomValue(0, 3)); };
 
   const int dirs[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
 
@@ -16,6 +16,9 @@ struct Velocity : public Position {};
 
 struct SteerDir : public Position {};
 
+// position before the last simulation step, rendering interpolates from it
+struct PrevPosition : public Position {};
+
 inline Position operator-(const Position &lhs, const Position &rhs)
 {
   return Position{lhs.x - rhs.x, lhs.y - rhs.y};
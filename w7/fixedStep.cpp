@@ -0,0 +1,18 @@
+#include "fixedStep.h"
+#include <algorithm>
+
+size_t advance_fixed_step(FixedStep &fs, float frame_dt)
+{
+  fs.accumulator += frame_dt;
+  size_t numSteps = 0;
+  while (fs.accumulator >= fs.stepDt && numSteps < fs.maxSubsteps)
+  {
+    fs.accumulator -= fs.stepDt;
+    numSteps++;
+  }
+  if (numSteps == fs.maxSubsteps)
+    fs.accumulator = std::min(fs.accumulator, fs.stepDt);
+  fs.stepCount += numSteps;
+  fs.alpha = fs.accumulator / fs.stepDt;
+  return numSteps;
+}
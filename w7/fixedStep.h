@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-step simulation clock: frame time is accumulated and the world is stepped with a constant
+// delta time, so simulation results don't depend on render frame rate.
+struct FixedStep
+{
+  float stepDt = 1.f / 60.f;
+  size_t maxSubsteps = 8; // frames longer than that drop simulation time instead of spiralling
+  float accumulator = 0.f;
+  float alpha = 1.f;      // render interpolation between the previous and the current step
+  uint64_t stepCount = 0;
+};
+
+// returns number of steps of stepDt to simulate this frame, updates alpha for rendering
+size_t advance_fixed_step(FixedStep &fs, float frame_dt);
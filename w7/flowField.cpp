@@ -0,0 +1,116 @@
+#include "flowField.h"
+#include "dungeonUtils.h"
+#include <queue>
+#include <cmath>
+
+constexpr float invalid_tile_value = 1e5f;
+
+static bool is_floor(const DungeonData &dd, int x, int y)
+{
+  return x >= 0 && y >= 0 && size_t(x) < dd.width && size_t(y) < dd.height &&
+         dd.tiles[size_t(y) * dd.width + size_t(x)] == dungeon::floor;
+}
+
+// diagonal steps need both side tiles free
+static bool can_step(const DungeonData &dd, int x, int y, int dx, int dy)
+{
+  if (!is_floor(dd, x + dx, y + dy))
+    return false;
+  return dx == 0 || dy == 0 || (is_floor(dd, x + dx, y) && is_floor(dd, x, y + dy));
+}
+
+constexpr int nei_dx[8] = {-1, 1, 0, 0, -1, 1, -1, 1};
+constexpr int nei_dy[8] = {0, 0, -1, 1, -1, -1, 1, 1};
+constexpr float nei_cost[8] = {1.f, 1.f, 1.f, 1.f, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f};
+
+void build_flow_field(FlowField &ff, const DungeonData &dd, float tile_size, const std::vector<Position> &targets)
+{
+  ff.width = dd.width;
+  ff.height = dd.height;
+  ff.tileSize = tile_size;
+  ff.dist.assign(dd.width * dd.height, invalid_tile_value);
+  ff.dir.assign(dd.width * dd.height, Position{0.f, 0.f});
+
+  using QueueItem = std::pair<float, size_t>;
+  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> openList;
+  for (const Position &t : targets)
+  {
+    // target tile is the one under the entity center
+    const int tx = int(floorf(t.x / tile_size + 0.5f));
+    const int ty = int(floorf(t.y / tile_size + 0.5f));
+    if (!is_floor(dd, tx, ty))
+      continue;
+    const size_t idx = size_t(ty) * dd.width + size_t(tx);
+    ff.dist[idx] = 0.f;
+    openList.emplace(0.f, idx);
+  }
+  while (!openList.empty())
+  {
+    const auto [d, idx] = openList.top();
+    openList.pop();
+    if (d > ff.dist[idx])
+      continue;
+    const int x = int(idx % dd.width);
+    const int y = int(idx / dd.width);
+    for (size_t i = 0; i < 8; ++i)
+    {
+      if (!can_step(dd, x, y, nei_dx[i], nei_dy[i]))
+        continue;
+      const size_t neiIdx = size_t(y + nei_dy[i]) * dd.width + size_t(x + nei_dx[i]);
+      const float neiDist = d + nei_cost[i];
+      if (neiDist >= ff.dist[neiIdx])
+        continue;
+      ff.dist[neiIdx] = neiDist;
+      openList.emplace(neiDist, neiIdx);
+    }
+  }
+
+  for (int y = 0; y < int(dd.height); ++y)
+    for (int x = 0; x < int(dd.width); ++x)
+    {
+      const size_t idx = size_t(y) * dd.width + size_t(x);
+      float minDist = ff.dist[idx];
+      if (minDist >= invalid_tile_value)
+        continue;
+      for (size_t i = 0; i < 8; ++i)
+      {
+        if (!can_step(dd, x, y, nei_dx[i], nei_dy[i]))
+          continue;
+        const float neiDist = ff.dist[size_t(y + nei_dy[i]) * dd.width + size_t(x + nei_dx[i])];
+        if (neiDist >= minDist)
+          continue;
+        minDist = neiDist;
+        ff.dir[idx] = normalize(Position{float(nei_dx[i]), float(nei_dy[i])});
+      }
+    }
+}
+
+Position sample_flow_field(const FlowField &ff, const Position &pos)
+{
+  // tile centers are at (x + 0.5) * tileSize, entity center is pos + 0.5 * tileSize
+  const float u = pos.x / ff.tileSize;
+  const float v = pos.y / ff.tileSize;
+  const float x0 = floorf(u);
+  const float y0 = floorf(v);
+  const float tx = u - x0;
+  const float ty = v - y0;
+  Position res{0.f, 0.f};
+  float weightSum = 0.f;
+  for (int j = 0; j < 2; ++j)
+    for (int i = 0; i < 2; ++i)
+    {
+      const float x = x0 + float(i);
+      const float y = y0 + float(j);
+      if (x < 0.f || y < 0.f || x >= float(ff.width) || y >= float(ff.height))
+        continue;
+      const size_t idx = size_t(y) * ff.width + size_t(x);
+      if (ff.dist[idx] >= invalid_tile_value)
+        continue;
+      const float w = (i ? tx : 1.f - tx) * (j ? ty : 1.f - ty);
+      res += ff.dir[idx] * w;
+      weightSum += w;
+    }
+  if (weightSum <= 0.f)
+    return Position{0.f, 0.f};
+  return res * (1.f / weightSum);
+}
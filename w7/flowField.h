@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+#include "ecsTypes.h"
+
+// Vector field towards the nearest target over the walkable tiles, shared by all agents.
+// Tile (x, y) covers [x, x + 1) * tileSize like the dungeon tile entities.
+struct FlowField
+{
+  size_t width = 0;
+  size_t height = 0;
+  float tileSize = 1.f;
+  std::vector<float> dist;   // dmap of tile distances, invalid on walls and unreachable tiles
+  std::vector<Position> dir; // unit direction to the downhill neighbour, zero on targets and invalid tiles
+};
+
+// multi-source Dijkstra from the target tiles over 8 neighbours without corner cutting
+void build_flow_field(FlowField &ff, const DungeonData &dd, float tile_size, const std::vector<Position> &targets);
+
+// bilinear blend of the 4 surrounding tile directions for an entity at pos (its tile corner),
+// invalid tiles are left out, returns zero when there is nothing to follow
+Position sample_flow_field(const FlowField &ff, const Position &pos);
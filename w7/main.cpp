@@ -1,10 +1,15 @@
 #include "raylib.h"
 #include <flecs.h>
 #include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
 
 #include "ecsTypes.h"
 #include "shootEmUp.h"
 #include "dungeonGen.h"
+#include "steering.h"
+#include "fixedStep.h"
 
 static void update_camera(flecs::world &ecs)
 {
@@ -22,8 +27,52 @@ static void update_camera(flecs::world &ecs)
 }
 
 
-int main(int /*argc*/, const char ** /*argv*/)
+// hw7 [--threads N] [--fixed-step STEPS_PER_SECOND] [--substeps MAX_STEPS_PER_FRAME] [--steer-bench NUM_AGENTS]
+//     [--seed N] [--flock-parity] [--flock-neighbours all|knearest|topological] [--flock-k MAX_NEIGHBOURS]
+int main(int argc, const char **argv)
 {
+  int numThreads = 1;
+  float fixedStepRate = 0.f; // variable step by default
+  size_t maxSubsteps = FixedStep{}.maxSubsteps;
+  steer::FlockParams flockParams;
+  bool hasSeed = false;
+  unsigned seed = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--flock-parity") == 0)
+      flockParams.mode = steer::FLOCK_PARITY_TEST;
+    else if (i + 1 == argc)
+      break;
+    else if (strcmp(argv[i], "--threads") == 0)
+      numThreads = std::max(atoi(argv[i + 1]), 1);
+    else if (strcmp(argv[i], "--seed") == 0)
+    {
+      hasSeed = true;
+      seed = unsigned(strtoul(argv[i + 1], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "--fixed-step") == 0)
+      fixedStepRate = std::max(float(atof(argv[i + 1])), 0.f);
+    else if (strcmp(argv[i], "--substeps") == 0)
+      maxSubsteps = size_t(std::max(atoi(argv[i + 1]), 1));
+    else if (strcmp(argv[i], "--flock-neighbours") == 0)
+    {
+      if (strcmp(argv[i + 1], "knearest") == 0)
+        flockParams.neighbourhood = steer::FLOCK_NEIGHBOURS_K_NEAREST;
+      else if (strcmp(argv[i + 1], "topological") == 0)
+        flockParams.neighbourhood = steer::FLOCK_NEIGHBOURS_TOPOLOGICAL;
+      else
+        flockParams.neighbourhood = steer::FLOCK_NEIGHBOURS_ALL;
+    }
+    else if (strcmp(argv[i], "--flock-k") == 0)
+      flockParams.maxNeighbours = size_t(std::clamp(atoi(argv[i + 1]), 1, 64));
+    else if (strcmp(argv[i], "--steer-bench") == 0)
+    {
+      const int maxThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+      steer::run_scaling_benchmark(size_t(std::max(atoi(argv[i + 1]), 0)), maxThreads, 300);
+      return 0;
+    }
+  }
+
   int width = 1920;
   int height = 1080;
   InitWindow(width, height, "w6 AI MIPT");
@@ -37,7 +86,13 @@ int main(int /*argc*/, const char ** /*argv*/)
     SetWindowSize(width, height);
   }
 
+  // InitWindow seeds raylib with the time, dungeon and spawns follow the seed from here on
+  if (hasSeed)
+    SetRandomSeed(seed);
+
   flecs::world ecs;
+  if (numThreads > 1)
+    ecs.set_threads(numThreads);
   {
     constexpr size_t dungWidth = 50;
     constexpr size_t dungHeight = 50;
@@ -45,7 +100,15 @@ int main(int /*argc*/, const char ** /*argv*/)
     gen_drunk_dungeon(tiles, dungWidth, dungHeight);
     init_dungeon(ecs, tiles, dungWidth, dungHeight);
   }
-  init_shoot_em_up(ecs);
+  init_shoot_em_up(ecs, flockParams);
+  if (fixedStepRate > 0.f)
+  {
+    FixedStep fixedStep;
+    fixedStep.stepDt = 1.f / fixedStepRate;
+    fixedStep.maxSubsteps = maxSubsteps;
+    ecs.entity("simulation")
+      .set(fixedStep);
+  }
 
   Camera2D camera = { {0, 0}, {0, 0}, 0.f, 1.f };
   camera.target = Vector2{ 0.f, 0.f };
@@ -60,13 +123,23 @@ int main(int /*argc*/, const char ** /*argv*/)
   {
     static auto cameraQuery = ecs.query<Camera2D>();
     process_game(ecs);
+    if (fixedStepRate > 0.f)
+    {
+      FixedStep *fixedStep = ecs.entity("simulation").get_mut<FixedStep>();
+      const size_t numSteps = advance_fixed_step(*fixedStep, GetFrameTime());
+      for (size_t i = 0; i < numSteps; ++i)
+        ecs.progress(fixedStep->stepDt);
+    }
+    else
+      ecs.progress();
     update_camera(ecs);
 
     BeginDrawing();
       ClearBackground(BLACK);
       cameraQuery.each([&](Camera2D &cam) { BeginMode2D(cam); });
-        ecs.progress();
+        render_game(ecs);
       EndMode2D();
+      render_hud(ecs);
       // Advance to next frame. Process submitted rendering primitives.
     EndDrawing();
   }
@@ -6,6 +6,7 @@ flecs::entity create_monster(flecs::world &ecs, Position pos, Color col, const c
   flecs::entity textureSrc = ecs.entity(texture_src);
   return ecs.entity()
     .set(Position{pos.x, pos.y})
+    .set(PrevPosition{pos.x, pos.y})
     .set(Velocity{0.f, 0.f})
     .set(MoveSpeed{100.f})
     .set(Hitpoints{100.f})
@@ -22,6 +23,7 @@ void create_player(flecs::world &ecs, Position pos, const char *texture_src)
   flecs::entity textureSrc = ecs.entity(texture_src);
   ecs.entity("player")
     .set(Position{pos.x, pos.y})
+    .set(PrevPosition{pos.x, pos.y})
     .set(Velocity{0.f, 0.f})
     .set(MoveSpeed{350.f})
     .set(Hitpoints{100.f})
@@ -35,3 +37,73 @@ void create_player(flecs::world &ecs, Position pos, const char *texture_src)
     .set(MeleeDamage{50.f});
 }
 
+
+static flecs::entity create_monster_prefab(flecs::world &ecs, steer::Type type, Color col,
+                                           flecs::entity texture_src)
+{
+  // per monster state is overridden, so instances own it, the rest is shared by the type
+  flecs::entity prefab = ecs.prefab()
+    .set_override(Position{0.f, 0.f})
+    .set_override(PrevPosition{0.f, 0.f})
+    .set_override(Velocity{0.f, 0.f})
+    .set_override(MoveSpeed{100.f})
+    .set_override(Hitpoints{100.f})
+    .set_override(Action{EA_NOP})
+    .set_override(NumActions{1, 0})
+    .override<TextureSource>(texture_src)
+    .set(Color{col})
+    .set(Team{1})
+    .set(MeleeDamage{20.f})
+    .set(PooledMonster{type});
+  return steer::create_steer_prefab(prefab, type);
+}
+
+MonsterPool create_monster_pool(flecs::world &ecs, const Color *colors, const char *texture_src, size_t prewarm_count)
+{
+  flecs::entity textureSrc = ecs.entity(texture_src);
+  MonsterPool pool;
+  for (size_t i = 0; i < steer::Type::Num; ++i)
+  {
+    pool.prefabs[i] = create_monster_prefab(ecs, steer::Type(i), colors[i], textureSrc);
+    for (size_t j = 0; j < prewarm_count; ++j)
+      pool.freeMonsters[i].push_back(ecs.entity().is_a(pool.prefabs[i]).disable());
+    pool.numCreated += prewarm_count;
+  }
+  return pool;
+}
+
+flecs::entity spawn_monster(flecs::world &ecs, MonsterPool &pool, steer::Type type, Position pos)
+{
+  std::vector<flecs::entity> &freeMonsters = pool.freeMonsters[type];
+  flecs::entity e;
+  if (freeMonsters.empty())
+  {
+    e = ecs.entity().is_a(pool.prefabs[type]);
+    pool.numCreated++;
+  }
+  else
+  {
+    e = freeMonsters.back();
+    freeMonsters.pop_back();
+    e.enable();
+    pool.numReused++;
+  }
+  // components are owned already, sets don't move the entity between tables
+  const flecs::entity prefab = pool.prefabs[type];
+  return e.set(Position{pos.x, pos.y})
+    .set(PrevPosition{pos.x, pos.y})
+    .set(*prefab.get<Velocity>())
+    .set(*prefab.get<SteerDir>())
+    .set(*prefab.get<Hitpoints>())
+    .set(*prefab.get<Action>())
+    .set(*prefab.get<NumActions>());
+}
+
+void release_monster(MonsterPool &pool, flecs::entity e)
+{
+  const PooledMonster *pm = e.get<PooledMonster>();
+  if (!pm || e.has(flecs::Disabled))
+    return; // TODO: Assert
+  e.disable();
+  pool.freeMonsters[pm->type].push_back(e);
+}
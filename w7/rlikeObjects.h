@@ -1,7 +1,9 @@
 #pragma once
 #include <flecs.h>
+#include <vector>
 #include "raylib.h"
 #include "ecsTypes.h"
+#include "steering.h"
 
 flecs::entity create_monster(flecs::world &ecs, Position pos, Color col, const char *texture_src);
 void create_player(flecs::world &ecs, Position pos, const char *texture_src);
@@ -10,5 +12,27 @@ struct MonsterSpawner
 {
   float timeToSpawn;
   float timeBetweenSpawns;
+  size_t maxSpawnsPerFrame; // the rest of a long frame is spawned on the next ones
 };
 
+// steering type of a pooled monster, shared through its prefab
+struct PooledMonster
+{
+  steer::Type type;
+};
+
+// Monsters are instanced from a prefab per steering type with all their components in place,
+// so a spawn is a single table insert. Dead monsters are disabled and reused by later spawns.
+struct MonsterPool
+{
+  flecs::entity prefabs[steer::Type::Num];
+  std::vector<flecs::entity> freeMonsters[steer::Type::Num];
+  size_t numCreated = 0;
+  size_t numReused = 0;
+};
+
+// colors are per steering type, prewarm_count monsters of every type are created disabled upfront
+MonsterPool create_monster_pool(flecs::world &ecs, const Color *colors, const char *texture_src, size_t prewarm_count);
+flecs::entity spawn_monster(flecs::world &ecs, MonsterPool &pool, steer::Type type, Position pos);
+// disables e until it's spawned again, no system sees it meanwhile
+void release_monster(MonsterPool &pool, flecs::entity e);
@@ -3,15 +3,61 @@
 #include "ecsTypes.h"
 #include "rlikeObjects.h"
 #include "steering.h"
+#include "steerKernels.h"
 #include "dungeonGen.h"
 #include "dungeonUtils.h"
 #include "pathfinder.h"
+#include "fixedStep.h"
+#include "broadphase.h"
+#include <memory>
 
 constexpr float tile_size = 64.f;
 
-static void register_roguelike_systems(flecs::world &ecs)
+// Broadphase load, shown in the HUD
+struct BroadphaseStats
+{
+  // sums over the current stats period
+  size_t frames = 0;
+  size_t bodies = 0;
+  size_t playerMonsterPairs = 0;
+  size_t monsterPairs = 0;
+  size_t wallOverlaps = 0;
+  double milliseconds = 0.0;
+  // per frame averages of the last period
+  float avgBodies = 0.f;
+  float avgPlayerMonsterPairs = 0.f;
+  float avgMonsterPairs = 0.f;
+  float avgWallOverlaps = 0.f;
+  float avgMilliseconds = 0.f;
+};
+
+// read by render_game once per rendered frame, drawing systems share it instead of querying per entity
+struct RenderFrame
+{
+  bool interpolate = false; // fixed step mode
+  float alpha = 1.f;        // FixedStep::alpha of the frame
+};
+
+// drawing systems are not in the pipeline, render_game runs them once per rendered frame
+struct RenderSystems
+{
+  std::vector<flecs::system> systems;
+  std::shared_ptr<RenderFrame> frame;
+};
+
+static void register_roguelike_systems(flecs::world &ecs, const steer::FlockParams &flock_params)
 {
   static auto playerPosQuery = ecs.query<const Position, const IsPlayer>();
+  std::shared_ptr<RenderFrame> renderFrame = std::make_shared<RenderFrame>();
+  RenderSystems renderSystems;
+  renderSystems.frame = renderFrame;
+
+  ecs.system<PrevPosition, const Position>()
+    .each([&](PrevPosition &prev, const Position &pos)
+    {
+      prev.x = pos.x;
+      prev.y = pos.y;
+    });
 
   ecs.system<Velocity, const MoveSpeed, const IsPlayer>()
     .each([&](Velocity &vel, const MoveSpeed &ms, const IsPlayer)
@@ -24,12 +70,74 @@ static void register_roguelike_systems(flecs::world &ecs)
       vel.y = ((up ? -1.f : 0.f) + (down ? 1.f : 0.f));
       vel = Velocity{normalize(vel) * ms.speed};
     });
+  // steering agents are integrated by the steering SoA pass
   ecs.system<Position, const Velocity>()
+    .without<SteerDir>()
     .each([&](Position &pos, const Velocity &vel)
     {
       pos += vel * ecs.delta_time();
     });
-  ecs.system<const Position, const Color>()
+  steer::register_systems(ecs, tile_size, flock_params);
+
+  // overlaps after all movement of the frame, hits are taken from them
+  static auto bodiesQuery = ecs.query<const Position, const Team>();
+  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  ecs.system<Broadphase>()
+    .each([&](Broadphase &bp)
+    {
+      clear_broadphase_bodies(bp);
+      bodiesQuery.each([&](flecs::entity e, const Position &pos, const Team &team)
+      {
+        push_broadphase_body(bp, e, pos, tile_size, team.team);
+      });
+      const DungeonData *dungeonData = nullptr;
+      dungeonDataQuery.each([&](const DungeonData &dd) { dungeonData = &dd; });
+      build_broadphase_pairs(bp, dungeonData, tile_size);
+    });
+  ecs.system<const Broadphase>()
+    .each([&](const Broadphase &bp)
+    {
+      // melee damage is dealt per second of contact both ways
+      for (const OverlapPair &pair : bp.playerMonsterPairs)
+      {
+        const flecs::entity player = bp.entities[pair.a];
+        const flecs::entity monster = bp.entities[pair.b];
+        Hitpoints *playerHp = player.get_mut<Hitpoints>();
+        Hitpoints *monsterHp = monster.get_mut<Hitpoints>();
+        const MeleeDamage *playerDmg = player.get<MeleeDamage>();
+        const MeleeDamage *monsterDmg = monster.get<MeleeDamage>();
+        if (!playerHp || !monsterHp || !playerDmg || !monsterDmg)
+          continue;
+        playerHp->hitpoints -= monsterDmg->damage * ecs.delta_time();
+        monsterHp->hitpoints -= playerDmg->damage * ecs.delta_time();
+      }
+    });
+  ecs.system<BroadphaseStats, const Broadphase>()
+    .each([&](BroadphaseStats &stats, const Broadphase &bp)
+    {
+      stats.bodies += bp.entities.size();
+      stats.playerMonsterPairs += bp.playerMonsterPairs.size();
+      stats.monsterPairs += bp.monsterPairs.size();
+      stats.wallOverlaps += bp.wallOverlaps.size();
+      stats.milliseconds += bp.buildMilliseconds;
+      constexpr size_t statsPeriod = 60;
+      if (++stats.frames < statsPeriod)
+        return;
+      const double invFrames = 1.0 / double(stats.frames);
+      stats.avgBodies = float(double(stats.bodies) * invFrames);
+      stats.avgPlayerMonsterPairs = float(double(stats.playerMonsterPairs) * invFrames);
+      stats.avgMonsterPairs = float(double(stats.monsterPairs) * invFrames);
+      stats.avgWallOverlaps = float(double(stats.wallOverlaps) * invFrames);
+      stats.avgMilliseconds = float(stats.milliseconds * invFrames);
+      stats.frames = 0;
+      stats.bodies = 0;
+      stats.playerMonsterPairs = 0;
+      stats.monsterPairs = 0;
+      stats.wallOverlaps = 0;
+      stats.milliseconds = 0.0;
+    });
+  renderSystems.systems.push_back(ecs.system<const Position, const Color>()
+    .kind(0)
     .with<TextureSource>(flecs::Wildcard)
     .with<BackgroundTile>()
     .each([&](flecs::entity e, const Position &pos, const Color color)
@@ -38,48 +146,65 @@ static void register_roguelike_systems(flecs::world &ecs)
       DrawTextureQuad(*textureSrc.get<Texture2D>(),
           Vector2{1, 1}, Vector2{0, 0},
           Rectangle{float(pos.x), float(pos.y), tile_size, tile_size}, color);
-    });
-  ecs.system<const Position, const Color>()
+    }));
+  renderSystems.systems.push_back(ecs.system<const Position, const Color>()
+    .kind(0)
     .with<TextureSource>(flecs::Wildcard)
     .without<BackgroundTile>()
-    .each([&](flecs::entity e, const Position &pos, const Color color)
+    .each([renderFrame](flecs::entity e, const Position &pos, const Color color)
     {
+      // in fixed step mode moving entities are drawn between the last two simulation steps
+      Position drawPos = pos;
+      const PrevPosition *prev = renderFrame->interpolate ? e.get<PrevPosition>() : nullptr;
+      if (prev)
+        drawPos = *prev + (pos - *prev) * renderFrame->alpha;
       const auto textureSrc = e.target<TextureSource>();
       DrawTextureQuad(*textureSrc.get<Texture2D>(),
           Vector2{1, 1}, Vector2{0, 0},
-          Rectangle{float(pos.x), float(pos.y), tile_size, tile_size}, color);
-    });
+          Rectangle{drawPos.x, drawPos.y, tile_size, tile_size}, color);
+    }));
 
-  ecs.system<Texture2D>()
+  renderSystems.systems.push_back(ecs.system<Texture2D>()
+    .kind(0)
     .each([&](Texture2D &tex)
     {
       SetTextureFilter(tex, TEXTURE_FILTER_POINT);
-    });
+    }));
 
-  ecs.system<MonsterSpawner>()
-    .each([&](MonsterSpawner &ms)
+  ecs.system<MonsterSpawner, MonsterPool>()
+    .each([&](MonsterSpawner &ms, MonsterPool &pool)
     {
       playerPosQuery.each([&](const Position &pp, const IsPlayer &)
       {
         ms.timeToSpawn -= ecs.delta_time();
-        while (ms.timeToSpawn < 0.f)
+        size_t numSpawned = 0;
+        while (ms.timeToSpawn < 0.f && numSpawned++ < ms.maxSpawnsPerFrame)
         {
           steer::Type st = steer::Type(GetRandomValue(0, steer::Type::Num - 1));
-          const Color colors[steer::Type::Num] = {WHITE, RED, BLUE, GREEN};
-          const float distances[steer::Type::Num] = {800.f, 800.f, 300.f, 300.f};
+          const float distances[steer::Type::Num] = {800.f, 800.f, 300.f, 300.f, 800.f};
           const float dist = distances[st];
           constexpr int angRandMax = 1 << 16;
           const float angle = float(GetRandomValue(0, angRandMax)) / float(angRandMax) * PI * 2.f;
-          Color col = colors[st];
-          steer::create_steer_beh(create_monster(ecs,
-              {pp.x + cosf(angle) * dist, pp.y + sinf(angle) * dist}, col, "minotaur_tex"), st);
+          spawn_monster(ecs, pool, st, {pp.x + cosf(angle) * dist, pp.y + sinf(angle) * dist});
           ms.timeToSpawn += ms.timeBetweenSpawns;
         }
       });
     });
 
+  static auto pooledMonstersQuery = ecs.query<const Hitpoints, const PooledMonster>();
+  ecs.system<MonsterPool>()
+    .each([&](MonsterPool &pool)
+    {
+      pooledMonstersQuery.each([&](flecs::entity e, const Hitpoints &hp, const PooledMonster &)
+      {
+        if (hp.hitpoints <= 0.f)
+          release_monster(pool, e);
+      });
+    });
+
   static auto cameraQuery = ecs.query<const Camera2D>();
-  ecs.system<const DungeonPortals, const DungeonData>()
+  renderSystems.systems.push_back(ecs.system<const DungeonPortals, const DungeonData>()
+    .kind(0)
     .each([&](const DungeonPortals &dp, const DungeonData &dd)
     {
       size_t w = dd.width;
@@ -136,14 +261,15 @@ static void register_roguelike_systems(flecs::world &ecs)
           }
         }
       });
-    });
-  steer::register_systems(ecs);
+    }));
+  ecs.entity("render_systems")
+    .set(renderSystems);
 }
 
 
-void init_shoot_em_up(flecs::world &ecs)
+void init_shoot_em_up(flecs::world &ecs, const steer::FlockParams &flock_params)
 {
-  register_roguelike_systems(ecs);
+  register_roguelike_systems(ecs, flock_params);
 
   ecs.entity("swordsman_tex")
     .set(Texture2D{LoadTexture("assets/swordsman.png")});
@@ -152,6 +278,15 @@ void init_shoot_em_up(flecs::world &ecs)
 
   const Position walkableTile = dungeon::find_walkable_tile(ecs);
   create_player(ecs, walkableTile * tile_size, "swordsman_tex");
+  steer::create_target(ecs.entity("player"));
+
+  const Color monsterColors[steer::Type::Num] = {WHITE, RED, BLUE, GREEN, YELLOW};
+  ecs.entity("monster_spawner")
+    .set(MonsterSpawner{0.f, 0.1f, 64})
+    .set(create_monster_pool(ecs, monsterColors, "minotaur_tex", 256));
+  ecs.entity("broadphase")
+    .set(Broadphase{})
+    .set(BroadphaseStats{});
 }
 
 void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h)
@@ -189,3 +324,39 @@ void process_game(flecs::world &ecs)
 {
 }
 
+void render_game(flecs::world &ecs)
+{
+  static auto renderSystemsQuery = ecs.query<const RenderSystems>();
+  static auto fixedStepQuery = ecs.query<const FixedStep>();
+  renderSystemsQuery.each([&](const RenderSystems &rs)
+  {
+    rs.frame->interpolate = false;
+    fixedStepQuery.each([&](const FixedStep &fs)
+    {
+      rs.frame->interpolate = true;
+      rs.frame->alpha = fs.alpha;
+    });
+    for (const flecs::system &sys : rs.systems)
+      sys.run();
+  });
+}
+
+void render_hud(flecs::world &ecs)
+{
+  static auto steerStatsQuery = ecs.query<const steer::SteerStats>();
+  steerStatsQuery.each([&](const steer::SteerStats &stats)
+  {
+    DrawText(TextFormat("steering (%s): %d agents/ms", steer::get_kernel_isa_name(), int(stats.agentsPerMs)),
+             20, 20, 20, WHITE);
+    if (stats.parityAgents > 0)
+      DrawText(TextFormat("flocking parity: %d agents bit exact", int(stats.parityAgents)), 20, 40, 20, WHITE);
+  });
+  static auto broadphaseStatsQuery = ecs.query<const BroadphaseStats>();
+  broadphaseStatsQuery.each([&](const BroadphaseStats &stats)
+  {
+    DrawText(TextFormat("broadphase: %d bodies, %.1f player/monster, %.1f monster/monster, %.1f wall overlaps, %.3f ms",
+                        int(stats.avgBodies), double(stats.avgPlayerMonsterPairs), double(stats.avgMonsterPairs),
+                        double(stats.avgWallOverlaps), double(stats.avgMilliseconds)),
+             20, 60, 20, WHITE);
+  });
+}
@@ -1,7 +1,12 @@
 #pragma once
 #include <flecs.h>
+#include "steering.h"
 
-void init_shoot_em_up(flecs::world &ecs);
+void init_shoot_em_up(flecs::world &ecs, const steer::FlockParams &flock_params = {});
 void process_game(flecs::world &ecs);
+// draws the world, simulation is advanced separately with ecs.progress
+void render_game(flecs::world &ecs);
+// screen space stats, drawn after the world
+void render_hud(flecs::world &ecs);
 void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h);
 
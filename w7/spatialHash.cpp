@@ -0,0 +1,37 @@
+#include "spatialHash.h"
+
+void build_spatial_hash(SpatialHash &hash, float cell_size, const std::vector<Position> &points)
+{
+  hash.cellSize = cell_size;
+  hash.invCellSize = 1.f / cell_size;
+  uint32_t tableSize = 64;
+  while (tableSize < points.size() * 2)
+    tableSize <<= 1;
+  hash.tableMask = tableSize - 1;
+
+  // counting sort by bucket
+  hash.bucketStart.assign(tableSize + 1, 0);
+  hash.pointBucket.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    const Position &p = points[i];
+    const uint32_t bucket = spatial_hash_bucket(hash, spatial_hash_cell(hash, p.x), spatial_hash_cell(hash, p.y));
+    hash.pointBucket[i] = bucket;
+    hash.bucketStart[bucket + 1]++;
+  }
+  for (uint32_t i = 0; i < tableSize; ++i)
+    hash.bucketStart[i + 1] += hash.bucketStart[i];
+
+  hash.points.resize(points.size());
+  hash.indices.resize(points.size());
+  // bucketStart[b] is used as an insertion cursor and ends up at bucketStart[b + 1], shift it back afterwards
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    const uint32_t dst = hash.bucketStart[hash.pointBucket[i]]++;
+    hash.points[dst] = points[i];
+    hash.indices[dst] = uint32_t(i);
+  }
+  for (uint32_t i = tableSize; i > 0; --i)
+    hash.bucketStart[i] = hash.bucketStart[i - 1];
+  hash.bucketStart[0] = 0;
+}
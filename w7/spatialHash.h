@@ -0,0 +1,178 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "ecsTypes.h"
+
+// Uniform grid over an unbounded world, cells are hashed into a power of two table.
+// Cell size equals the query radius so every query touches only 3x3 cells.
+struct SpatialHash
+{
+  float cellSize = 1.f;
+  float invCellSize = 1.f;
+  uint32_t tableMask = 0;
+  std::vector<uint32_t> bucketStart; // tableMask + 2 offsets into points/indices
+  std::vector<Position> points;      // sorted by bucket
+  std::vector<uint32_t> indices;     // original index of each sorted point
+  std::vector<uint32_t> pointBucket; // scratch for the counting sort
+};
+
+// rebuilds in place, buffers are reused between frames
+void build_spatial_hash(SpatialHash &hash, float cell_size, const std::vector<Position> &points);
+
+inline int32_t spatial_hash_cell(const SpatialHash &hash, float v)
+{
+  return int32_t(floorf(v * hash.invCellSize));
+}
+
+inline uint32_t spatial_hash_bucket(const SpatialHash &hash, int32_t cx, int32_t cy)
+{
+  return ((uint32_t(cx) * 73856093u) ^ (uint32_t(cy) * 19349663u)) & hash.tableMask;
+}
+
+// distinct buckets of the 3x3 cells around pos, different cells can share a bucket
+inline size_t get_neighbour_buckets(const SpatialHash &hash, const Position &pos, uint32_t (&buckets)[9])
+{
+  const int32_t cx = spatial_hash_cell(hash, pos.x);
+  const int32_t cy = spatial_hash_cell(hash, pos.y);
+  size_t numBuckets = 0;
+  for (int32_t y = cy - 1; y <= cy + 1; ++y)
+    for (int32_t x = cx - 1; x <= cx + 1; ++x)
+    {
+      const uint32_t bucket = spatial_hash_bucket(hash, x, y);
+      bool visited = false;
+      for (size_t i = 0; i < numBuckets && !visited; ++i)
+        visited = buckets[i] == bucket;
+      if (!visited)
+        buckets[numBuckets++] = bucket;
+    }
+  return numBuckets;
+}
+
+// calls c(original_index, dist_sq) for every point within cellSize of pos, pos itself included
+template<typename Callable>
+inline void for_each_neighbour(const SpatialHash &hash, const Position &pos, Callable c)
+{
+  if (hash.points.empty())
+    return;
+  uint32_t buckets[9];
+  const size_t numBuckets = get_neighbour_buckets(hash, pos, buckets);
+  const float radiusSq = hash.cellSize * hash.cellSize;
+  for (size_t i = 0; i < numBuckets; ++i)
+    for (uint32_t j = hash.bucketStart[buckets[i]]; j < hash.bucketStart[buckets[i] + 1]; ++j)
+    {
+      const float distSq = length_sq(hash.points[j] - pos);
+      if (distSq > radiusSq)
+        continue;
+      c(hash.indices[j], distSq);
+    }
+}
+
+// Same points as for_each_neighbour in ascending original index, so sums over them round the same
+// for any cell size. Buckets hold their points in index order and are merged.
+template<typename Callable>
+inline void for_each_neighbour_ordered(const SpatialHash &hash, const Position &pos, Callable c)
+{
+  if (hash.points.empty())
+    return;
+  uint32_t buckets[9];
+  const size_t numBuckets = get_neighbour_buckets(hash, pos, buckets);
+  uint32_t cursors[9];
+  uint32_t ends[9];
+  for (size_t i = 0; i < numBuckets; ++i)
+  {
+    cursors[i] = hash.bucketStart[buckets[i]];
+    ends[i] = hash.bucketStart[buckets[i] + 1];
+  }
+  const float radiusSq = hash.cellSize * hash.cellSize;
+  while (true)
+  {
+    size_t best = numBuckets;
+    for (size_t i = 0; i < numBuckets; ++i)
+      if (cursors[i] < ends[i] && (best == numBuckets || hash.indices[cursors[i]] < hash.indices[cursors[best]]))
+        best = i;
+    if (best == numBuckets)
+      break;
+    const uint32_t j = cursors[best]++;
+    const float distSq = length_sq(hash.points[j] - pos);
+    if (distSq > radiusSq)
+      continue;
+    c(hash.indices[j], distSq);
+  }
+}
+
+// calls c(original_index, dist_sq) for points of cell (cx, cy) only, bucket mates from other cells are skipped
+template<typename Callable>
+inline void for_each_in_cell(const SpatialHash &hash, int32_t cx, int32_t cy, const Position &pos, Callable c)
+{
+  const uint32_t bucket = spatial_hash_bucket(hash, cx, cy);
+  for (uint32_t j = hash.bucketStart[bucket]; j < hash.bucketStart[bucket + 1]; ++j)
+  {
+    const Position &p = hash.points[j];
+    if (spatial_hash_cell(hash, p.x) != cx || spatial_hash_cell(hash, p.y) != cy)
+      continue;
+    c(hash.indices[j], length_sq(p - pos));
+  }
+}
+
+struct NearestNeighbour
+{
+  uint32_t idx;
+  float distSq;
+};
+
+// Up to k nearest accepted points within max_dist, sorted by distance (then by index).
+// Cells are scanned in rings around pos and the scan stops once no unvisited cell can hold
+// a closer point, so dense crowds cost about k points instead of everything in max_dist.
+template<typename Predicate>
+inline size_t find_nearest_neighbours(const SpatialHash &hash, const Position &pos, float max_dist, size_t k,
+                                      NearestNeighbour *res, Predicate accept)
+{
+  if (hash.points.empty() || k == 0)
+    return 0;
+  auto closer = [](const NearestNeighbour &lhs, const NearestNeighbour &rhs)
+  {
+    return lhs.distSq < rhs.distSq || (lhs.distSq == rhs.distSq && lhs.idx < rhs.idx);
+  };
+  const float maxDistSq = max_dist * max_dist;
+  const int32_t cx = spatial_hash_cell(hash, pos.x);
+  const int32_t cy = spatial_hash_cell(hash, pos.y);
+  const int32_t maxRing = int32_t(ceilf(max_dist * hash.invCellSize));
+  size_t count = 0; // res[0..count) is a max heap by distance while searching
+  auto visit = [&](uint32_t idx, float distSq)
+  {
+    if (distSq > maxDistSq || !accept(idx))
+      return;
+    const NearestNeighbour nn{idx, distSq};
+    if (count < k)
+    {
+      res[count++] = nn;
+      std::push_heap(res, res + count, closer);
+    }
+    else if (closer(nn, res[0]))
+    {
+      std::pop_heap(res, res + count, closer);
+      res[count - 1] = nn;
+      std::push_heap(res, res + count, closer);
+    }
+  };
+  for (int32_t ring = 0; ring <= maxRing; ++ring)
+  {
+    // points of this ring are at least (ring - 1) cells away
+    const float ringDist = float(ring - 1) * hash.cellSize;
+    if (count == k && ring > 0 && res[0].distSq <= ringDist * ringDist)
+      break;
+    for (int32_t y = cy - ring; y <= cy + ring; ++y)
+    {
+      const bool edgeRow = y == cy - ring || y == cy + ring;
+      for (int32_t x = cx - ring; x <= cx + ring; x += edgeRow ? 1 : 2 * ring)
+      {
+        for_each_in_cell(hash, x, y, pos, visit);
+        if (ring == 0)
+          break;
+      }
+    }
+  }
+  std::sort(res, res + count, closer);
+  return count;
+}
@@ -0,0 +1,67 @@
+#include "steering.h"
+#include "ecsTypes.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+static void populate_benchmark_world(flecs::world &ecs, size_t num_agents)
+{
+  steer::create_target(ecs.entity("player")
+    .set(Position{0.f, 0.f})
+    .set(Velocity{100.f, 0.f})
+    .set(Hitpoints{100.f})
+    .add<IsPlayer>());
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> coord(-4000.f, 4000.f);
+  for (size_t i = 0; i < num_agents; ++i)
+  {
+    flecs::entity e = ecs.entity()
+      .set(Position{coord(rng), coord(rng)})
+      .set(Velocity{0.f, 0.f})
+      .set(MoveSpeed{100.f})
+      .set(Hitpoints{100.f});
+    steer::create_steer_beh(e, steer::Type(i % steer::Type::Num));
+  }
+}
+
+void steer::run_scaling_benchmark(size_t num_agents, int max_threads, size_t num_frames)
+{
+  constexpr float dt = 1.f / 60.f;
+  constexpr size_t warmupFrames = 10;
+  const FlockNeighbourhood neighbourhoods[] =
+    {FLOCK_NEIGHBOURS_ALL, FLOCK_NEIGHBOURS_K_NEAREST, FLOCK_NEIGHBOURS_TOPOLOGICAL};
+  const char *neighbourhoodNames[] = {"all", "k-nearest", "topological"};
+  constexpr size_t numNeighbourhoods = sizeof(neighbourhoods) / sizeof(neighbourhoods[0]);
+  double singleThreadMs[numNeighbourhoods] = {};
+  for (int threads = 1; threads <= max_threads; ++threads)
+  {
+    double allNeighboursMs = 0.0;
+    for (size_t n = 0; n < numNeighbourhoods; ++n)
+    {
+      FlockParams flockParams;
+      flockParams.neighbourhood = neighbourhoods[n];
+      flecs::world ecs;
+      ecs.set_threads(threads);
+      register_systems(ecs, 64.f, flockParams);
+      populate_benchmark_world(ecs, num_agents);
+      for (size_t i = 0; i < warmupFrames; ++i)
+        ecs.progress(dt);
+
+      using clock = std::chrono::steady_clock;
+      const clock::time_point startTime = clock::now();
+      for (size_t i = 0; i < num_frames; ++i)
+        ecs.progress(dt);
+      const double frameMs =
+        std::chrono::duration<double, std::milli>(clock::now() - startTime).count() / double(num_frames);
+      if (threads == 1)
+        singleThreadMs[n] = frameMs;
+      if (neighbourhoods[n] == FLOCK_NEIGHBOURS_ALL)
+        allNeighboursMs = frameMs;
+      // bounded neighbourhoods are compared with all neighbours on the same thread count
+      printf("%2d threads, %-11s: %8.3f ms/frame, %8.0f agents/ms, x%.2f, x%.2f over all\n", threads,
+             neighbourhoodNames[n], frameMs, double(num_agents) / frameMs, singleThreadMs[n] / frameMs,
+             allNeighboursMs / frameMs);
+    }
+  }
+}
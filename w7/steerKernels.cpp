@@ -0,0 +1,256 @@
+#include "steerKernels.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+void clear_steer_soa(SteerSoA &soa)
+{
+  soa.posX.clear();
+  soa.posY.clear();
+  soa.velX.clear();
+  soa.velY.clear();
+  soa.dirX.clear();
+  soa.dirY.clear();
+  soa.speed.clear();
+  soa.accel.clear();
+}
+
+void push_steer_agent(SteerSoA &soa, float pos_x, float pos_y, float vel_x, float vel_y, float dir_x, float dir_y,
+                      float speed, float accel)
+{
+  soa.posX.push_back(pos_x);
+  soa.posY.push_back(pos_y);
+  soa.velX.push_back(vel_x);
+  soa.velY.push_back(vel_y);
+  soa.dirX.push_back(dir_x);
+  soa.dirY.push_back(dir_y);
+  soa.speed.push_back(speed);
+  soa.accel.push_back(accel);
+}
+
+// Kernels are written once against these ops, every op mirrors the scalar math of ecsTypes.h
+struct ScalarOps
+{
+  using V = float;
+  static constexpr size_t width = 1;
+  static V load(const float *p) { return *p; }
+  static void store(float *p, V v) { *p = v; }
+  static V set1(float v) { return v; }
+  static V add(V a, V b) { return a + b; }
+  static V sub(V a, V b) { return a - b; }
+  static V mul(V a, V b) { return a * b; }
+  static V div(V a, V b) { return a / b; }
+  static V sqrt(V a) { return sqrtf(a); }
+  static V min(V a, V b) { return b < a ? b : a; }
+  static V max(V a, V b) { return a < b ? b : a; }
+  static V safeinv(V v) { return fabsf(v) > 1e-7f ? 1.f / v : v; }
+  // a > b ? x : y
+  static V select_gt(V a, V b, V x, V y) { return a > b ? x : y; }
+};
+
+#if defined(__AVX2__)
+struct SimdOps
+{
+  using V = __m256;
+  static constexpr size_t width = 8;
+  static const char *name() { return "avx2"; }
+  static V load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+  static V set1(float v) { return _mm256_set1_ps(v); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm256_div_ps(a, b); }
+  static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+  // operand order matches ScalarOps::min/max for NaN inputs
+  static V min(V a, V b) { return _mm256_min_ps(b, a); }
+  static V max(V a, V b) { return _mm256_max_ps(b, a); }
+  static V select_gt(V a, V b, V x, V y) { return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+  static V safeinv(V v)
+  {
+    const V absV = _mm256_andnot_ps(_mm256_set1_ps(-0.f), v);
+    return select_gt(absV, set1(1e-7f), div(set1(1.f), v), v);
+  }
+};
+#elif defined(__SSE2__) || defined(_M_X64)
+struct SimdOps
+{
+  using V = __m128;
+  static constexpr size_t width = 4;
+  static const char *name() { return "sse2"; }
+  static V load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+  static V set1(float v) { return _mm_set1_ps(v); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm_div_ps(a, b); }
+  static V sqrt(V a) { return _mm_sqrt_ps(a); }
+  // operand order matches ScalarOps::min/max for NaN inputs
+  static V min(V a, V b) { return _mm_min_ps(b, a); }
+  static V max(V a, V b) { return _mm_max_ps(b, a); }
+  static V select_gt(V a, V b, V x, V y)
+  {
+    const V mask = _mm_cmpgt_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+  }
+  static V safeinv(V v)
+  {
+    const V absV = _mm_andnot_ps(_mm_set1_ps(-0.f), v);
+    return select_gt(absV, set1(1e-7f), div(set1(1.f), v), v);
+  }
+};
+#else
+struct SimdOps : public ScalarOps
+{
+  static const char *name() { return "scalar"; }
+};
+#endif
+
+template<typename Ops>
+static void integrate_positions_impl(SteerSoA &soa, size_t i, typename Ops::V dt)
+{
+  Ops::store(&soa.posX[i], Ops::add(Ops::load(&soa.posX[i]), Ops::mul(Ops::load(&soa.velX[i]), dt)));
+  Ops::store(&soa.posY[i], Ops::add(Ops::load(&soa.posY[i]), Ops::mul(Ops::load(&soa.velY[i]), dt)));
+}
+
+// scale which truncates a vector of length l to len
+template<typename Ops>
+static typename Ops::V truncate_scale(typename Ops::V l, typename Ops::V len)
+{
+  return Ops::select_gt(l, len, Ops::div(len, l), Ops::set1(1.f));
+}
+
+template<typename Ops>
+static typename Ops::V length(typename Ops::V x, typename Ops::V y)
+{
+  return Ops::sqrt(Ops::add(Ops::mul(x, x), Ops::mul(y, y)));
+}
+
+template<typename Ops>
+static void update_velocities_impl(SteerSoA &soa, size_t i, typename Ops::V dt)
+{
+  using V = typename Ops::V;
+  const V speed = Ops::load(&soa.speed[i]);
+  const V accel = Ops::load(&soa.accel[i]);
+  const V dirX = Ops::load(&soa.dirX[i]);
+  const V dirY = Ops::load(&soa.dirY[i]);
+  const V dirScale = truncate_scale<Ops>(length<Ops>(dirX, dirY), speed);
+  const V velX = Ops::add(Ops::load(&soa.velX[i]), Ops::mul(Ops::mul(Ops::mul(dirX, dirScale), dt), accel));
+  const V velY = Ops::add(Ops::load(&soa.velY[i]), Ops::mul(Ops::mul(Ops::mul(dirY, dirScale), dt), accel));
+  const V velScale = truncate_scale<Ops>(length<Ops>(velX, velY), speed);
+  Ops::store(&soa.velX[i], Ops::mul(velX, velScale));
+  Ops::store(&soa.velY[i], Ops::mul(velY, velScale));
+}
+
+// dir += normalize(dx, dy) * speed - vel
+template<typename Ops>
+static void add_desired_velocity(SteerSoA &soa, size_t i, typename Ops::V dx, typename Ops::V dy)
+{
+  using V = typename Ops::V;
+  const V inv = Ops::safeinv(length<Ops>(dx, dy));
+  const V speed = Ops::load(&soa.speed[i]);
+  Ops::store(&soa.dirX[i], Ops::add(Ops::load(&soa.dirX[i]),
+                                    Ops::sub(Ops::mul(Ops::mul(dx, inv), speed), Ops::load(&soa.velX[i]))));
+  Ops::store(&soa.dirY[i], Ops::add(Ops::load(&soa.dirY[i]),
+                                    Ops::sub(Ops::mul(Ops::mul(dy, inv), speed), Ops::load(&soa.velY[i]))));
+}
+
+template<typename Ops>
+static void seek_impl(SteerSoA &soa, size_t i, typename Ops::V tx, typename Ops::V ty)
+{
+  add_desired_velocity<Ops>(soa, i, Ops::sub(tx, Ops::load(&soa.posX[i])), Ops::sub(ty, Ops::load(&soa.posY[i])));
+}
+
+template<typename Ops>
+static void flee_impl(SteerSoA &soa, size_t i, typename Ops::V tx, typename Ops::V ty)
+{
+  add_desired_velocity<Ops>(soa, i, Ops::sub(Ops::load(&soa.posX[i]), tx), Ops::sub(Ops::load(&soa.posY[i]), ty));
+}
+
+template<typename Ops>
+static void evade_impl(SteerSoA &soa, size_t i, typename Ops::V tx, typename Ops::V ty,
+                       typename Ops::V tvx, typename Ops::V tvy)
+{
+  using V = typename Ops::V;
+  const V px = Ops::load(&soa.posX[i]);
+  const V py = Ops::load(&soa.posY[i]);
+  const V dposX = Ops::sub(px, tx);
+  const V dposY = Ops::sub(py, ty);
+  const V dist = length<Ops>(dposX, dposY);
+  const V dvelX = Ops::sub(Ops::load(&soa.velX[i]), tvx);
+  const V dvelY = Ops::sub(Ops::load(&soa.velY[i]), tvy);
+  const V dotProduct = Ops::mul(Ops::add(Ops::mul(dvelX, dposX), Ops::mul(dvelY, dposY)), Ops::safeinv(dist));
+  const V interceptTime = Ops::mul(dotProduct, Ops::safeinv(length<Ops>(dvelX, dvelY)));
+  const V predictTime = Ops::max(Ops::min(Ops::set1(4.f), Ops::mul(interceptTime, Ops::set1(0.9f))), Ops::set1(1.f));
+  const V targetX = Ops::add(tx, Ops::mul(tvx, predictTime));
+  const V targetY = Ops::add(ty, Ops::mul(tvy, predictTime));
+  add_desired_velocity<Ops>(soa, i, Ops::sub(px, targetX), Ops::sub(py, targetY));
+}
+
+// runs kernel(ops, index) over full SIMD batches, then over the tail with scalar ops
+template<typename SimdKernel, typename ScalarKernel>
+static void for_each_batch(size_t begin, size_t end, SimdKernel simd_kernel, ScalarKernel scalar_kernel)
+{
+  size_t i = begin;
+  for (; i + SimdOps::width <= end; i += SimdOps::width)
+    simd_kernel(i);
+  for (; i < end; ++i)
+    scalar_kernel(i);
+}
+
+const char *steer::get_kernel_isa_name()
+{
+  return SimdOps::name();
+}
+
+void steer::integrate_positions(SteerSoA &soa, size_t begin, size_t end, float dt)
+{
+  for_each_batch(begin, end,
+    [&](size_t i) { integrate_positions_impl<SimdOps>(soa, i, SimdOps::set1(dt)); },
+    [&](size_t i) { integrate_positions_impl<ScalarOps>(soa, i, dt); });
+}
+
+void steer::update_velocities(SteerSoA &soa, size_t begin, size_t end, float dt)
+{
+  for_each_batch(begin, end,
+    [&](size_t i) { update_velocities_impl<SimdOps>(soa, i, SimdOps::set1(dt)); },
+    [&](size_t i) { update_velocities_impl<ScalarOps>(soa, i, dt); });
+}
+
+void steer::seek_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y)
+{
+  for_each_batch(begin, end,
+    [&](size_t i) { seek_impl<SimdOps>(soa, i, SimdOps::set1(target_x), SimdOps::set1(target_y)); },
+    [&](size_t i) { seek_impl<ScalarOps>(soa, i, target_x, target_y); });
+}
+
+void steer::flee_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y)
+{
+  for_each_batch(begin, end,
+    [&](size_t i) { flee_impl<SimdOps>(soa, i, SimdOps::set1(target_x), SimdOps::set1(target_y)); },
+    [&](size_t i) { flee_impl<ScalarOps>(soa, i, target_x, target_y); });
+}
+
+void steer::pursue_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y,
+                          float target_vel_x, float target_vel_y)
+{
+  constexpr float predictTime = 4.f;
+  seek_kernel(soa, begin, end, target_x + target_vel_x * predictTime, target_y + target_vel_y * predictTime);
+}
+
+void steer::evade_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y,
+                         float target_vel_x, float target_vel_y)
+{
+  for_each_batch(begin, end,
+    [&](size_t i)
+    {
+      evade_impl<SimdOps>(soa, i, SimdOps::set1(target_x), SimdOps::set1(target_y),
+                          SimdOps::set1(target_vel_x), SimdOps::set1(target_vel_y));
+    },
+    [&](size_t i) { evade_impl<ScalarOps>(soa, i, target_x, target_y, target_vel_x, target_vel_y); });
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Structure of arrays mirror of steering agents, components are split into x and y streams
+// so kernels can process several agents per instruction
+struct SteerSoA
+{
+  std::vector<float> posX, posY;
+  std::vector<float> velX, velY;
+  std::vector<float> dirX, dirY;
+  std::vector<float> speed;
+  std::vector<float> accel;
+};
+
+void clear_steer_soa(SteerSoA &soa);
+void push_steer_agent(SteerSoA &soa, float pos_x, float pos_y, float vel_x, float vel_y, float dir_x, float dir_y,
+                      float speed, float accel);
+inline size_t get_steer_soa_size(const SteerSoA &soa) { return soa.posX.size(); }
+
+// AVX2 when built with it (hw7_avx2), SSE2 on x86-64, scalar otherwise.
+// Leftover agents of every kernel go through the scalar path, results are identical between paths.
+namespace steer
+{
+  const char *get_kernel_isa_name();
+
+  // pos += vel * dt
+  void integrate_positions(SteerSoA &soa, size_t begin, size_t end, float dt);
+  // vel = truncate(vel + truncate(dir, speed) * dt * accel, speed)
+  void update_velocities(SteerSoA &soa, size_t begin, size_t end, float dt);
+
+  // dir += desired velocity - vel for the given target
+  void seek_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y);
+  void flee_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y);
+  void pursue_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y,
+                     float target_vel_x, float target_vel_y);
+  void evade_kernel(SteerSoA &soa, size_t begin, size_t end, float target_x, float target_y,
+                    float target_vel_x, float target_vel_y);
+};
@@ -1,16 +1,277 @@
 #include "steering.h"
 #include "ecsTypes.h"
+#include "spatialHash.h"
+#include "steerKernels.h"
+#include "flowField.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
 
 struct Seeker {};
 struct Pursuer {};
 struct Evader {};
 struct Fleer {};
+struct FlowFollower {};
 struct Separation {};
 struct Alignment {};
 struct Cohesion {};
 
+struct Target {};
+
 struct SteerAccel { float accel = 1.f; };
 
+struct SteerNeighbours
+{
+  steer::FlockParams params;
+  std::vector<flecs::entity> entities;
+  std::vector<Position> positions;
+  std::vector<Velocity> velocities;
+  // separate mode, keyed by each behaviour radius
+  SpatialHash separationHash;
+  SpatialHash alignmentHash;
+  SpatialHash cohesionHash;
+  // fused modes, keyed by the largest radius or by the smallest one for bounded neighbourhoods
+  SpatialHash flockHash;
+};
+
+// Per-frame data of the steering systems. Only single-threaded systems write it,
+// multithreaded ones read it and write just the components of their own entities.
+struct SteerContext
+{
+  SteerNeighbours neighbours;
+  // copy of the SteerTargets snapshot, workers read it instead of querying targets per agent
+  steer::SteerTargets targets;
+  FlowField flowField;
+  bool hasFlowField = false; // there's no dungeon in headless runs
+  // agents checked by the parity test in the last frame
+  std::atomic<size_t> parityAgents{0};
+  // wall time of the whole steering phase, all workers included
+  std::chrono::steady_clock::time_point phaseStart;
+  size_t statFrames = 0;
+  size_t statAgents = 0;
+  double statMilliseconds = 0.0;
+};
+
+typedef void (*steer_kernel)(const SteerContext &ctx, SteerSoA &soa, size_t count);
+
+static void seek_targets(const SteerContext &ctx, SteerSoA &soa, size_t count)
+{
+  for (const Position &tp : ctx.targets.positions)
+    steer::seek_kernel(soa, 0, count, tp.x, tp.y);
+}
+
+static void pursue_targets(const SteerContext &ctx, SteerSoA &soa, size_t count)
+{
+  for (size_t i = 0; i < ctx.targets.positions.size(); ++i)
+  {
+    const Position &tp = ctx.targets.positions[i];
+    const Velocity &tvel = ctx.targets.velocities[i];
+    steer::pursue_kernel(soa, 0, count, tp.x, tp.y, tvel.x, tvel.y);
+  }
+}
+
+static void evade_targets(const SteerContext &ctx, SteerSoA &soa, size_t count)
+{
+  for (size_t i = 0; i < ctx.targets.positions.size(); ++i)
+  {
+    const Position &tp = ctx.targets.positions[i];
+    const Velocity &tvel = ctx.targets.velocities[i];
+    steer::evade_kernel(soa, 0, count, tp.x, tp.y, tvel.x, tvel.y);
+  }
+}
+
+static void flee_targets(const SteerContext &ctx, SteerSoA &soa, size_t count)
+{
+  for (const Position &tp : ctx.targets.positions)
+    steer::flee_kernel(soa, 0, count, tp.x, tp.y);
+}
+
+// one field lookup per agent, agents off the field (outside the dungeon or on the target tile) seek directly
+static void follow_flow_field(const SteerContext &ctx, SteerSoA &soa, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Position flow = ctx.hasFlowField ? sample_flow_field(ctx.flowField, Position{soa.posX[i], soa.posY[i]})
+                                           : Position{0.f, 0.f};
+    if (length_sq(flow) < 1e-4f)
+    {
+      for (const Position &tp : ctx.targets.positions)
+        steer::seek_kernel(soa, i, i + 1, tp.x, tp.y);
+      continue;
+    }
+    const Position desired = normalize(flow) * soa.speed[i];
+    soa.dirX[i] += desired.x - soa.velX[i];
+    soa.dirY[i] += desired.y - soa.velY[i];
+  }
+}
+
+// Integration, velocity update and behaviour of one table of agents in SoA form.
+// Tables are spread over workers, every worker has its own buffer.
+static void steer_table(const SteerContext &ctx, flecs::iter &it, Position *p, Velocity *vel, SteerDir *sd,
+                        const MoveSpeed *ms, const SteerAccel *sa, steer_kernel kernel)
+{
+  thread_local SteerSoA soa;
+  clear_steer_soa(soa);
+  const size_t count = it.count();
+  for (size_t i = 0; i < count; ++i)
+    push_steer_agent(soa, p[i].x, p[i].y, vel[i].x, vel[i].y, sd[i].x, sd[i].y, ms[i].speed, sa[i].accel);
+  const float dt = it.delta_time();
+  steer::integrate_positions(soa, 0, count, dt);
+  steer::update_velocities(soa, 0, count, dt);
+  std::fill(soa.dirX.begin(), soa.dirX.end(), 0.f);
+  std::fill(soa.dirY.begin(), soa.dirY.end(), 0.f);
+  kernel(ctx, soa, count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    p[i].x = soa.posX[i];
+    p[i].y = soa.posY[i];
+    vel[i].x = soa.velX[i];
+    vel[i].y = soa.velY[i];
+    sd[i].x = soa.dirX[i];
+    sd[i].y = soa.dirY[i];
+  }
+}
+
+template<typename Tag>
+static void register_steer_pass(flecs::world &ecs, std::shared_ptr<const SteerContext> ctx, steer_kernel kernel)
+{
+  ecs.system<Position, Velocity, SteerDir, const MoveSpeed, const SteerAccel>()
+    .with<Tag>()
+    .multi_threaded()
+    .iter([ctx, kernel](flecs::iter &it, Position *p, Velocity *vel, SteerDir *sd, const MoveSpeed *ms,
+                        const SteerAccel *sa)
+    {
+      steer_table(*ctx, it, p, vel, sd, ms, sa, kernel);
+    });
+}
+
+// Per-neighbour terms are shared by the fused and separate paths, each behaviour is summed
+// on its own and added to SteerDir as a whole. Neighbours are visited in snapshot order whatever
+// the hash cell size, so both paths round identically
+static Position separation_term(const steer::FlockParams &fp, const Position &p, const Position &op,
+                                const Velocity &vel, float dist_sq, float speed)
+{
+  return (p - op) * safeinv(dist_sq) * speed * fp.separationDist * fp.separationWeight - vel;
+}
+
+static Position cohesion_term(const steer::FlockParams &fp, const Position &p, const Velocity &vel,
+                              const Position &pos_sum, size_t count)
+{
+  return normalize(pos_sum * safeinv(float(count)) - p) * fp.cohesionWeight - vel;
+}
+
+static Position separation_force(const SteerNeighbours &sn, const SpatialHash &hash, flecs::entity ent,
+                                 const Position &p, const Velocity &vel, float speed)
+{
+  const float thresDistSq = sn.params.separationDist * sn.params.separationDist;
+  Position force{0.f, 0.f};
+  for_each_neighbour_ordered(hash, p, [&](uint32_t idx, float distSq)
+  {
+    if (distSq > thresDistSq || sn.entities[idx] == ent)
+      return;
+    force += separation_term(sn.params, p, sn.positions[idx], vel, distSq, speed);
+  });
+  return force;
+}
+
+static Position alignment_force(const SteerNeighbours &sn, const SpatialHash &hash, flecs::entity ent,
+                                const Position &p)
+{
+  const float thresDistSq = sn.params.alignmentDist * sn.params.alignmentDist;
+  Position force{0.f, 0.f};
+  for_each_neighbour_ordered(hash, p, [&](uint32_t idx, float distSq)
+  {
+    if (distSq > thresDistSq || sn.entities[idx] == ent)
+      return;
+    force += sn.velocities[idx] * sn.params.alignmentWeight;
+  });
+  return force;
+}
+
+static Position cohesion_force(const SteerNeighbours &sn, const SpatialHash &hash, flecs::entity ent,
+                               const Position &p, const Velocity &vel)
+{
+  const float thresDistSq = sn.params.cohesionDist * sn.params.cohesionDist;
+  Position posSum{0.f, 0.f};
+  size_t count = 0;
+  for_each_neighbour_ordered(hash, p, [&](uint32_t idx, float distSq)
+  {
+    if (distSq > thresDistSq || sn.entities[idx] == ent)
+      return;
+    count++;
+    posSum += sn.positions[idx];
+  });
+  return cohesion_term(sn.params, p, vel, posSum, count);
+}
+
+struct FlockForces
+{
+  Position separation;
+  Position alignment;
+  Position cohesion;
+};
+
+// at most this many neighbours in bounded neighbourhoods, they are kept in an inline buffer
+constexpr size_t max_flock_neighbours = 64;
+
+static bool is_flock_bounded(const steer::FlockParams &fp)
+{
+  return fp.mode == steer::FLOCK_FUSED && fp.neighbourhood != steer::FLOCK_NEIGHBOURS_ALL;
+}
+
+static FlockForces fused_flock_forces(const SteerNeighbours &sn, flecs::entity ent, const Position &p,
+                                      const Velocity &vel, float speed)
+{
+  const steer::FlockParams &fp = sn.params;
+  const float sepDistSq = fp.separationDist * fp.separationDist;
+  const float alignDistSq = fp.alignmentDist * fp.alignmentDist;
+  const float cohDistSq = fp.cohesionDist * fp.cohesionDist;
+  // topological neighbours are picked by rank, only separation stays metric
+  const bool metric = fp.neighbourhood != steer::FLOCK_NEIGHBOURS_TOPOLOGICAL;
+  FlockForces res{{0.f, 0.f}, {0.f, 0.f}, {0.f, 0.f}};
+  Position posSum{0.f, 0.f};
+  size_t count = 0;
+  auto accumulate = [&](uint32_t idx, float distSq)
+  {
+    if (distSq <= sepDistSq)
+      res.separation += separation_term(fp, p, sn.positions[idx], vel, distSq, speed);
+    if (!metric || distSq <= alignDistSq)
+      res.alignment += sn.velocities[idx] * fp.alignmentWeight;
+    if (!metric || distSq <= cohDistSq)
+    {
+      count++;
+      posSum += sn.positions[idx];
+    }
+  };
+  if (is_flock_bounded(fp))
+  {
+    NearestNeighbour nearest[max_flock_neighbours];
+    const size_t numNearest = find_nearest_neighbours(sn.flockHash, p, fp.cohesionDist,
+                                                      std::min(fp.maxNeighbours, max_flock_neighbours), nearest,
+                                                      [&](uint32_t idx) { return sn.entities[idx] != ent; });
+    for (size_t i = 0; i < numNearest; ++i)
+      accumulate(nearest[i].idx, nearest[i].distSq);
+  }
+  else
+    for_each_neighbour_ordered(sn.flockHash, p, [&](uint32_t idx, float distSq)
+    {
+      if (sn.entities[idx] != ent)
+        accumulate(idx, distSq);
+    });
+  res.cohesion = cohesion_term(fp, p, vel, posSum, count);
+  return res;
+}
+
+static bool is_bit_equal(const Position &lhs, const Position &rhs)
+{
+  return memcmp(&lhs, &rhs, sizeof(Position)) == 0;
+}
+
 static flecs::entity create_separation(flecs::entity e)
 {
   return e.add<Separation>();
@@ -55,6 +316,16 @@ flecs::entity steer::create_fleer(flecs::entity e)
   return create_steerer(e).add<Fleer>();
 }
 
+flecs::entity steer::create_flow_follower(flecs::entity e)
+{
+  return create_steerer(e).add<FlowFollower>();
+}
+
+flecs::entity steer::create_target(flecs::entity e)
+{
+  return e.add<Target>();
+}
+
 typedef flecs::entity (*create_foo)(flecs::entity);
 
 flecs::entity steer::create_steer_beh(flecs::entity e, Type type)
@@ -64,137 +335,180 @@ flecs::entity steer::create_steer_beh(flecs::entity e, Type type)
     create_seeker,
     create_pursuer,
     create_evader,
-    create_fleer
+    create_fleer,
+    create_flow_follower
   };
   return steerFoo[type](e);
 }
 
-
-void steer::register_systems(flecs::world &ecs)
+flecs::entity steer::create_steer_prefab(flecs::entity prefab, Type type)
 {
-  static auto playerPosQuery = ecs.query<const Position, const Velocity, const IsPlayer>();
+  // steering state is copied into every instance, behaviour tags stay on the prefab
+  return create_steer_beh(prefab, type)
+    .override<SteerDir>()
+    .override<SteerAccel>();
+}
 
-  ecs.system<Velocity, const MoveSpeed, const SteerDir, const SteerAccel>()
-    .each([&](Velocity &vel, const MoveSpeed &ms, const SteerDir &sd, const SteerAccel &sa)
-    {
-      vel = Velocity{truncate(vel + truncate(sd, ms.speed) * ecs.delta_time() * sa.accel, ms.speed)};
-    });
 
-  // reset steer dir
-  ecs.system<SteerDir>().each([&](SteerDir &sd) { sd = {0.f, 0.f}; });
+void steer::register_systems(flecs::world &ecs, float tile_size, const FlockParams &flock_params)
+{
+  // no statics and no world captures, systems own their queries and share the context,
+  // so the steering phase can be spread over flecs worker threads
+  std::shared_ptr<SteerContext> ctx = std::make_shared<SteerContext>();
+  ctx->neighbours.params = flock_params;
 
-  // seeker
-  ecs.system<SteerDir, const MoveSpeed, const Velocity, const Position, const Seeker>()
-    .each([&](SteerDir &sd, const MoveSpeed &ms, const Velocity &vel,
-              const Position &p, const Seeker &)
+  // targets snapshot is filled once per frame, before any agent is steered
+  auto targetQuery = ecs.query<const Position, const Velocity, const Target>();
+  auto steerQuery = ecs.query<const SteerDir>();
+  ecs.system<SteerTargets>()
+    .each([ctx, targetQuery, steerQuery](SteerTargets &targets) mutable
     {
-      playerPosQuery.each([&](const Position &pp, const Velocity &, const IsPlayer &)
+      ctx->phaseStart = std::chrono::steady_clock::now();
+      targets.positions.clear();
+      targets.velocities.clear();
+      targetQuery.each([&](const Position &tp, const Velocity &tvel, const Target &)
       {
-        sd += SteerDir{normalize(pp - p) * ms.speed - vel};
+        targets.positions.push_back(tp);
+        targets.velocities.push_back(tvel);
       });
+      ctx->targets = targets;
+      ctx->statAgents += size_t(steerQuery.count());
     });
 
-  // fleer
-  ecs.system<SteerDir, const MoveSpeed, const Velocity, const Position, const Fleer>()
-    .each([&](SteerDir &sd, const MoveSpeed &ms, const Velocity &vel, const Position &p, const Fleer &)
+  // flow field towards the targets over the dungeon tiles, one for all flow followers
+  ecs.system<const DungeonData>()
+    .each([ctx, tile_size](const DungeonData &dd)
     {
-      playerPosQuery.each([&](const Position &pp, const Velocity &, const IsPlayer &)
-      {
-        sd += SteerDir{normalize(p - pp) * ms.speed - vel};
-      });
+      build_flow_field(ctx->flowField, dd, tile_size, ctx->targets.positions);
+      ctx->hasFlowField = true;
     });
 
-  // pursuer
-  ecs.system<SteerDir, const MoveSpeed, const Velocity, const Position, const Pursuer>()
-    .each([&](SteerDir &sd, const MoveSpeed &ms, const Velocity &vel, const Position &p, const Pursuer &)
+  register_steer_pass<Seeker>(ecs, ctx, seek_targets);
+  register_steer_pass<Pursuer>(ecs, ctx, pursue_targets);
+  register_steer_pass<Evader>(ecs, ctx, evade_targets);
+  register_steer_pass<Fleer>(ecs, ctx, flee_targets);
+  register_steer_pass<FlowFollower>(ecs, ctx, follow_flow_field);
+
+  // read-only neighbour snapshot for the flocking systems, rebuilt after velocities are updated
+  auto otherQuery = ecs.query<const Position, const Velocity, const Hitpoints>();
+  ecs.system()
+    .iter([ctx, otherQuery](flecs::iter &) mutable
     {
-      playerPosQuery.each([&](const Position &pp, const Velocity &pvel, const IsPlayer &)
+      SteerNeighbours &sn = ctx->neighbours;
+      sn.entities.clear();
+      sn.positions.clear();
+      sn.velocities.clear();
+      otherQuery.each([&](flecs::entity oe, const Position &op, const Velocity &ovel, const Hitpoints &)
       {
-        constexpr float predictTime = 4.f;
-        const Position targetPos = pp + pvel * predictTime;
-        sd += SteerDir{normalize(targetPos - p) * ms.speed - vel};
+        sn.entities.push_back(oe);
+        sn.positions.push_back(op);
+        sn.velocities.push_back(ovel);
       });
+      const steer::FlockParams &fp = sn.params;
+      // the parity test runs the separate path as its reference
+      if (fp.mode != steer::FLOCK_FUSED)
+      {
+        build_spatial_hash(sn.separationHash, fp.separationDist, sn.positions);
+        build_spatial_hash(sn.alignmentHash, fp.alignmentDist, sn.positions);
+        build_spatial_hash(sn.cohesionHash, fp.cohesionDist, sn.positions);
+      }
+      if (fp.mode == steer::FLOCK_SEPARATE)
+        return;
+      if (is_flock_bounded(fp))
+        // fine cells, nearest neighbours search stops after a few rings in crowds
+        build_spatial_hash(sn.flockHash, std::min(std::min(fp.separationDist, fp.alignmentDist), fp.cohesionDist),
+                           sn.positions);
+      else
+        build_spatial_hash(sn.flockHash, std::max(std::max(fp.separationDist, fp.alignmentDist), fp.cohesionDist),
+                           sn.positions);
     });
 
-  // evader
-  ecs.system<SteerDir, const MoveSpeed, const Velocity, const Position, const Evader>()
-    .each([&](SteerDir &sd, const MoveSpeed &ms, const Velocity &vel, const Position &p, const Evader &)
-    {
-      playerPosQuery.each([&](const Position &pp, const Velocity &pvel,
-                              const IsPlayer &)
+  // every agent accumulates only into its own SteerDir
+  if (flock_params.mode == FLOCK_SEPARATE)
+  {
+    ecs.system<SteerDir, const Velocity, const MoveSpeed, const Position, const Separation>()
+      .multi_threaded()
+      .each([ctx](flecs::entity ent, SteerDir &sd, const Velocity &vel, const MoveSpeed &ms,
+                  const Position &p, const Separation &)
       {
-        constexpr float maxPredictTime = 4.f;
-        const Position dpos = p - pp;
-        const float dist = length(dpos);
-        const Position dvel = vel - pvel;
-        const float dotProduct = (dvel.x * dpos.x + dvel.y * dpos.y) * safeinv(dist);
-        const float interceptTime = dotProduct * safeinv(length(dvel));
-        const float predictTime = std::max(std::min(maxPredictTime, interceptTime * 0.9f), 1.f);
-
-        const Position targetPos = pp + pvel * predictTime;
-        sd += SteerDir{normalize(p - targetPos) * ms.speed - vel};
+        const SteerNeighbours &sn = ctx->neighbours;
+        sd += SteerDir{separation_force(sn, sn.separationHash, ent, p, vel, ms.speed)};
       });
-    });
-
-  static auto otherPosQuery = ecs.query<const Position, const Hitpoints>();
 
-  // separation is expensive!!!
-  ecs.system<SteerDir, const Velocity, const MoveSpeed, const Position, const Separation>()
-    .each([&](flecs::entity ent, SteerDir &sd, const Velocity &vel, const MoveSpeed &ms,
-              const Position &p, const Separation &)
-    {
-      otherPosQuery.each([&](flecs::entity oe, const Position &op, const Hitpoints &)
+    ecs.system<SteerDir, const Position, const Alignment>()
+      .multi_threaded()
+      .each([ctx](flecs::entity ent, SteerDir &sd, const Position &p, const Alignment &)
       {
-        if (oe == ent)
-          return;
-        constexpr float thresDist = 70.f;
-        constexpr float thresDistSq = thresDist * thresDist;
-        const float distSq = length_sq(op - p);
-        if (distSq > thresDistSq)
-          return;
-        sd += SteerDir{(p - op) * safeinv(distSq) * ms.speed * thresDist - vel};
+        const SteerNeighbours &sn = ctx->neighbours;
+        sd += SteerDir{alignment_force(sn, sn.alignmentHash, ent, p)};
       });
-    });
 
-  static auto otherVelQuery = ecs.query<const Position, const Velocity>();
-  ecs.system<SteerDir, const Velocity, const MoveSpeed, const Position, const Alignment>()
-    .each([&](flecs::entity ent, SteerDir &sd, const Velocity &vel, const MoveSpeed &ms,
-              const Position &p, const Alignment &)
-    {
-      otherVelQuery.each([&](flecs::entity oe, const Position &op, const Velocity &ovel)
+    ecs.system<SteerDir, const Velocity, const Position, const Cohesion>()
+      .multi_threaded()
+      .each([ctx](flecs::entity ent, SteerDir &sd, const Velocity &vel, const Position &p, const Cohesion &)
       {
-        if (oe == ent)
-          return;
-        constexpr float thresDist = 100.f;
-        constexpr float thresDistSq = thresDist * thresDist;
-        const float distSq = length_sq(op - p);
-        if (distSq > thresDistSq)
-          return;
-        sd += SteerDir{ovel * 0.8f};
+        const SteerNeighbours &sn = ctx->neighbours;
+        sd += SteerDir{cohesion_force(sn, sn.cohesionHash, ent, p, vel)};
       });
-    });
-
-  ecs.system<SteerDir, const Velocity, const MoveSpeed, const Position, const Cohesion>()
-    .each([&](flecs::entity ent, SteerDir &sd, const Velocity &vel, const MoveSpeed &ms,
-              const Position &p, const Cohesion &)
-    {
-      Position avgPos{0.f, 0.f};
-      size_t count = 0;
-      otherPosQuery.each([&](flecs::entity oe, const Position &op, const Hitpoints &)
+  }
+  else
+  {
+    ecs.system<SteerDir, const Velocity, const MoveSpeed, const Position>()
+      .with<Separation>()
+      .with<Alignment>()
+      .with<Cohesion>()
+      .multi_threaded()
+      .each([ctx](flecs::entity ent, SteerDir &sd, const Velocity &vel, const MoveSpeed &ms, const Position &p)
       {
-        if (oe == ent)
-          return;
-        constexpr float thresDist = 500.f;
-        constexpr float thresDistSq = thresDist * thresDist;
-        const float distSq = length_sq(op - p);
-        if (distSq > thresDistSq)
-          return;
-        count++;
-        avgPos += op;
+        const SteerNeighbours &sn = ctx->neighbours;
+        const FlockForces forces = fused_flock_forces(sn, ent, p, vel, ms.speed);
+        if (sn.params.mode == FLOCK_PARITY_TEST)
+        {
+          // exactly what the FLOCK_SEPARATE systems would add, with their hashes and neighbour order
+          const FlockForces reference{separation_force(sn, sn.separationHash, ent, p, vel, ms.speed),
+                                      alignment_force(sn, sn.alignmentHash, ent, p),
+                                      cohesion_force(sn, sn.cohesionHash, ent, p, vel)};
+          if (!is_bit_equal(reference.separation, forces.separation) ||
+              !is_bit_equal(reference.alignment, forces.alignment) ||
+              !is_bit_equal(reference.cohesion, forces.cohesion))
+          {
+            fprintf(stderr, "flocking parity failed for entity %" PRIu64 ": separation %a %a / %a %a, "
+                    "alignment %a %a / %a %a, cohesion %a %a / %a %a\n", ent.id(),
+                    double(forces.separation.x), double(forces.separation.y),
+                    double(reference.separation.x), double(reference.separation.y),
+                    double(forces.alignment.x), double(forces.alignment.y),
+                    double(reference.alignment.x), double(reference.alignment.y),
+                    double(forces.cohesion.x), double(forces.cohesion.y),
+                    double(reference.cohesion.x), double(reference.cohesion.y));
+            abort();
+          }
+          ctx->parityAgents++;
+        }
+        sd += SteerDir{forces.separation};
+        sd += SteerDir{forces.alignment};
+        sd += SteerDir{forces.cohesion};
       });
-      constexpr float avgPosMult = 100.f;
-      sd += SteerDir{normalize(avgPos * safeinv(float(count)) - p) * avgPosMult - vel};
+  }
+
+  // stats for the HUD, nothing is printed from the steering phase
+  ecs.system<SteerStats>()
+    .each([ctx](SteerStats &stats)
+    {
+      stats.parityAgents = ctx->parityAgents.exchange(0);
+      ctx->statMilliseconds +=
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ctx->phaseStart).count();
+      constexpr size_t statsPeriod = 60;
+      if (++ctx->statFrames < statsPeriod)
+        return;
+      if (ctx->statMilliseconds > 0.0)
+        stats.agentsPerMs = float(double(ctx->statAgents) / ctx->statMilliseconds);
+      ctx->statFrames = 0;
+      ctx->statAgents = 0;
+      ctx->statMilliseconds = 0.0;
     });
 
+  ecs.entity("steer_targets")
+    .set(SteerTargets{});
+  ecs.entity("steer_stats")
+    .set(SteerStats{});
 }
-
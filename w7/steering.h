@@ -1,5 +1,7 @@
 #pragma once
 #include <flecs.h>
+#include <vector>
+#include "ecsTypes.h"
 
 namespace steer
 {
@@ -9,16 +11,76 @@ namespace steer
     StPursuer,
     StEvader,
     StFleer,
+    StFlowFollower,
     Num
   };
 
+  // FLOCK_SEPARATE is the parity reference, but it is a rewrite of the original three systems, not a copy.
+  // Each behaviour sums its force over the neighbour snapshot (Position, Velocity and Hitpoints) and adds it
+  // to SteerDir once. The original systems added every neighbour term to SteerDir in query order, and
+  // alignment took its neighbours from all Position + Velocity entities.
+  enum FlockMode
+  {
+    FLOCK_FUSED = 0,   // single neighbour traversal for separation, alignment and cohesion
+    FLOCK_SEPARATE,    // one system and one traversal per behaviour, rewritten as described above
+    FLOCK_PARITY_TEST  // fused, aborts unless it matches the FLOCK_SEPARATE traversals run alongside it bit by bit
+  };
+
+  enum FlockNeighbourhood
+  {
+    FLOCK_NEIGHBOURS_ALL = 0,    // every agent within the behaviour radius
+    FLOCK_NEIGHBOURS_K_NEAREST,  // at most maxNeighbours nearest, each behaviour keeps its radius
+    FLOCK_NEIGHBOURS_TOPOLOGICAL // at most maxNeighbours nearest within cohesion radius, by rank only
+  };
+
+  struct FlockParams
+  {
+    float separationDist = 70.f;
+    float alignmentDist = 100.f;
+    float cohesionDist = 500.f;
+    float separationWeight = 1.f;
+    float alignmentWeight = 0.8f;
+    float cohesionWeight = 100.f;
+    FlockMode mode = FLOCK_FUSED;
+    // bounded neighbourhoods cap the cost per agent in crowds, used by FLOCK_FUSED only
+    FlockNeighbourhood neighbourhood = FLOCK_NEIGHBOURS_ALL;
+    size_t maxNeighbours = 7; // up to 64
+  };
+
+  // Per-frame snapshot of everything agents seek, flee, pursue or evade
+  struct SteerTargets
+  {
+    std::vector<Position> positions;
+    std::vector<Velocity> velocities;
+  };
+
+  // Filled by the steering systems every frame, drawn by the HUD
+  struct SteerStats
+  {
+    float agentsPerMs = 0.f; // over the last stats period, all workers included
+    size_t parityAgents = 0; // checked by the parity test in the last frame, a mismatch aborts
+  };
+
   flecs::entity create_steer_beh(flecs::entity e, Type type);
+  // same behaviour on a prefab, its instances get their own steering state
+  flecs::entity create_steer_prefab(flecs::entity prefab, Type type);
 
   flecs::entity create_seeker(flecs::entity e);
   flecs::entity create_pursuer(flecs::entity e);
   flecs::entity create_evader(flecs::entity e);
   flecs::entity create_fleer(flecs::entity e);
+  // follows the flow field towards the targets around dungeon walls
+  flecs::entity create_flow_follower(flecs::entity e);
+  // designates e (Position + Velocity) as a target of all steering agents, players are targets
+  flecs::entity create_target(flecs::entity e);
+
+  // steering systems are multi threaded, worker count is set on the world with set_threads
+  // tile_size maps dungeon tiles to world positions for the flow field
+  void register_systems(flecs::world &ecs, float tile_size, const FlockParams &flock_params = {});
 
-  void register_systems(flecs::world &ecs);
+  // headless, runs steering of num_agents agents around a player with 1..max_threads workers
+  // for every flocking neighbourhood and prints frame time, throughput, speedup over a single thread
+  // and speedup over all neighbours
+  void run_scaling_benchmark(size_t num_agents, int max_threads, size_t num_frames);
 };
 